@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <mdspan>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace brma
+{
+    /// @brief The type must be a 2D mdspan of bool.
+    template <typename T>
+    concept bool_2d_mdspan =
+        requires {
+        typename T::element_type;
+        typename T::extents_type;
+    } &&
+        (std::same_as<typename T::element_type, bool> ||
+            std::same_as<typename T::element_type, const bool>) &&
+        (T::extents_type::rank() == 2);
+
+    namespace detail
+    {
+        /// @brief Points at a single bit in an array of 64-bit words.
+        struct bit_pointer
+        {
+            uint64_t const* words;
+            std::size_t bit;
+        };
+
+        /// @brief Accessor that reads bools out of packed 64-bit words, bit 0
+        /// first. Pair it with a layout whose offsets are bit indices.
+        struct bit_accessor
+        {
+            using element_type = bool const;
+            using reference = bool;
+            using data_handle_type = bit_pointer;
+            using offset_policy = bit_accessor;
+
+            [[nodiscard]] constexpr reference access(data_handle_type p, std::size_t i) const noexcept
+            {
+                std::size_t const bit{ p.bit + i };
+                return ((p.words[bit / 64] >> (bit % 64)) & 1U) != 0;
+            }
+
+            [[nodiscard]] constexpr data_handle_type offset(data_handle_type p, std::size_t i) const noexcept
+            {
+                return { p.words, p.bit + i };
+            }
+        };
+    }
+
+    /// @brief A 2D mask packed 64 pixels to a word.
+    ///
+    /// Each row starts on a word boundary and pixel (i, j) is bit j % 64 of
+    /// word j / 64 of row i. Bits past the last column are always clear so
+    /// whole words can be consumed without masking.
+    class bit_mask
+    {
+        std::size_t rows_{ 0 };
+        std::size_t cols_{ 0 };
+        std::size_t words_per_row_{ 0 };
+        std::pmr::vector<uint64_t> words_;
+    public:
+        /// @brief A bool mdspan view of a bit_mask.
+        using view_type = std::mdspan<bool const, std::dextents<std::size_t, 2>, std::layout_stride, detail::bit_accessor>;
+
+        bit_mask() = default;
+
+        /// @brief Makes a rows x cols mask with every pixel set to value,
+        /// allocating its words from resource.
+        bit_mask(std::size_t rows, std::size_t cols, bool value = false,
+                 std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+            : rows_{ rows }, cols_{ cols }, words_per_row_{ (cols + 63) / 64 }, words_(rows * words_per_row_, resource)
+        {
+            fill(value);
+        }
+
+        /// @brief Packs the given bool mask.
+        template <bool_2d_mdspan MaskSpan>
+        explicit bit_mask(MaskSpan const& mask) : bit_mask(mask.extent(0), mask.extent(1))
+        {
+            for (std::size_t i = 0; i < rows_; ++i)
+            {
+                for (std::size_t j = 0; j < cols_; ++j)
+                {
+                    if (mask[i, j])
+                    {
+                        words_[(i * words_per_row_) + (j / 64)] |= uint64_t{ 1 } << (j % 64);
+                    }
+                }
+            }
+        }
+
+        [[nodiscard]] auto rows() const -> std::size_t { return rows_; }
+        [[nodiscard]] auto cols() const -> std::size_t { return cols_; }
+        [[nodiscard]] auto words_per_row() const -> std::size_t { return words_per_row_; }
+
+        /// @brief Gets the packed words of row i.
+        [[nodiscard]] auto row(std::size_t i) const -> std::span<uint64_t const>
+        {
+            return std::span{ words_ }.subspan(i * words_per_row_, words_per_row_);
+        }
+
+        /// @brief Gets the packed words of row i for writing a word at a
+        /// time. Bits past the last column must be left clear.
+        [[nodiscard]] auto row(std::size_t i) -> std::span<uint64_t>
+        {
+            return std::span{ words_ }.subspan(i * words_per_row_, words_per_row_);
+        }
+
+        [[nodiscard]] auto operator[](std::size_t i, std::size_t j) const -> bool
+        {
+            return ((words_[(i * words_per_row_) + (j / 64)] >> (j % 64)) & 1U) != 0;
+        }
+
+        /// @brief Sets or clears pixel (i, j).
+        auto set(std::size_t i, std::size_t j, bool value = true) -> void
+        {
+            assert(i < rows_ && j < cols_);
+            uint64_t &word{ words_[(i * words_per_row_) + (j / 64)] };
+            uint64_t const bit{ uint64_t{ 1 } << (j % 64) };
+            word = value ? word | bit : word & ~bit;
+        }
+
+        /// @brief Sets every pixel to value, leaving the row padding clear.
+        auto fill(bool value) -> void
+        {
+            if (!value || words_per_row_ == 0)
+            {
+                std::ranges::fill(words_, uint64_t{ 0 });
+                return;
+            }
+
+            std::ranges::fill(words_, ~uint64_t{ 0 });
+            if (std::size_t const tail{ cols_ % 64 }; tail != 0)
+            {
+                for (std::size_t i = 0; i < rows_; ++i)
+                {
+                    words_[(i * words_per_row_) + words_per_row_ - 1] = (uint64_t{ 1 } << tail) - 1;
+                }
+            }
+        }
+
+        /// @brief Counts the set pixels.
+        [[nodiscard]] auto count() const -> std::size_t
+        {
+            std::size_t ret{ 0 };
+            for (uint64_t const word : words_)
+            {
+                ret += static_cast<std::size_t>(std::popcount(word));
+            }
+
+            return ret;
+        }
+
+        /// @brief Gets the mask as a 2D mdspan of bool.
+        [[nodiscard]] auto view() const -> view_type
+        {
+            return view_of(words_.data(), rows_, cols_);
+        }
+
+        /// @brief Views words packed the way a bit_mask packs them, such as
+        /// a mask saved to a file, without copying them.
+        [[nodiscard]] static auto view_of(uint64_t const *words, std::size_t rows, std::size_t cols) -> view_type
+        {
+            return view_type{
+                detail::bit_pointer{ words, 0 },
+                std::layout_stride::mapping{ std::dextents<std::size_t, 2>{ rows, cols }, std::array<std::size_t, 2>{ ((cols + 63) / 64) * 64, 1 } },
+                detail::bit_accessor{} };
+        }
+    };
+}
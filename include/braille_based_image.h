@@ -1,29 +1,38 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit_mask.h>
+#include <cassert>
 #include <concepts>
 #include <cstdint>
+#include <cstring>
+#include <execution>
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 #include <mdspan>
+#include <memory>
 #include <numeric>
+#include <ostream>
 #include <ranges>
+#include <span>
+#include <stats.h>
 #include <string>
+#include <string_view>
 #include <utf8cpp/utf8.h>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <system_error>
+#include <unistd.h>
+#define BRMA_POSIX_FD 1
+#else
+#define BRMA_POSIX_FD 0
+#endif
+
 namespace brma
 {
-    /// @brief The type must be a 2D mdspan of bool.
-    template <typename T>
-    concept bool_2d_mdspan =
-        requires {
-        typename T::element_type;
-        typename T::extents_type;
-    } &&
-        (std::same_as<typename T::element_type, bool> ||
-            std::same_as<typename T::element_type, const bool>) &&
-        (T::extents_type::rank() == 2);
-
     namespace detail
     {
         template <typename T>
@@ -58,19 +67,20 @@ namespace brma
             T base;
             int pad_top;
             int pad_left;
+            std::size_t padded_width;
 
             using element_type = bool const;
-            using reference = bool const;
+            using reference = bool;
             using data_handle_type = bool const*;
             using offset_policy = padded_bool_accessor;
 
 
-            constexpr padded_bool_accessor(T const& base, size_t pt, size_t pl)
-                : base{ base }, pad_top{ static_cast<int>(pt) }, pad_left{ static_cast<int>(pl) }
+            constexpr padded_bool_accessor(T const& b, size_t pt, size_t pl, size_t pw)
+                : base{ b }, pad_top{ static_cast<int>(pt) }, pad_left{ static_cast<int>(pl) }, padded_width{ pw }
             {}
 
 
-            constexpr reference access(data_handle_type p, std::size_t i, std::size_t j) const
+            constexpr reference access(data_handle_type, std::size_t i, std::size_t j) const
             {
                 int const orig_i = static_cast<int>(i) - pad_top;
                 int const orig_j = static_cast<int>(j) - pad_left;
@@ -79,9 +89,10 @@ namespace brma
                     base[orig_i, orig_j]);
             }
 
-            constexpr reference access(data_handle_type p, std::size_t n) const
+            constexpr reference access(data_handle_type, std::size_t n) const
             {
-                return (*this)(n / base.extent(1), n % base.extent(1));
+                // n is an offset into the padded view, not the base.
+                return (*this)(n / padded_width, n % padded_width);
             }
 
             constexpr reference operator()(data_handle_type p, std::size_t i, std::size_t j) const
@@ -109,7 +120,7 @@ namespace brma
             BoolSpan padded_view;
 
             using element_type = uint32_t const;
-            using reference = uint32_t const;
+            using reference = uint32_t;
             using data_handle_type = std::nullptr_t;
             using offset_policy = braille_accessor;
 
@@ -251,6 +262,7 @@ namespace brma
                     })
                 | std::ranges::to<std::vector>();
         }
+
     }
 
     /// Tell the mask_braille method to include a border or not.
@@ -260,56 +272,625 @@ namespace brma
         line,
     };
 
+    namespace detail
+    {
+        template <typename T>
+        concept contiguous_bool_mdspan =
+            bool_2d_mdspan<T> &&
+            std::same_as<typename T::layout_type, std::layout_right> &&
+            std::same_as<typename T::accessor_type, std::default_accessor<typename T::element_type>>;
+
+        template <typename T>
+        concept static_bool_mdspan = bool_2d_mdspan<T> && T::rank_dynamic() == 0;
+
+        // A row of false to stand in for padding rows of a static width mask.
+        template <size_t Cols>
+        inline constexpr std::array<bool, Cols> false_row{};
+
+        // Braille dot bits for one mask row. Byte k of entry b holds the dots
+        // that bits 2k (left) and 2k + 1 (right) of b make in cell k; left and
+        // right are the dot bits of the leftmost pixel pair in the row.
+        constexpr auto braille_row_lut(uint8_t left, uint8_t right) -> std::array<uint32_t, 256>
+        {
+            std::array<uint32_t, 256> ret{};
+            for (uint32_t b = 0; b < 256; ++b)
+            {
+                for (uint32_t k = 0; k < 4; ++k)
+                {
+                    uint32_t const dots{ (((b >> (2 * k)) & 1U) * left) | (((b >> ((2 * k) + 1)) & 1U) * right) };
+                    ret[b] |= dots << (8 * k);
+                }
+            }
+
+            return ret;
+        }
+
+        // Rows 0 to 2 of a cell use dots 0x01/0x08 shifted down by the row,
+        // row 3 uses 0x40/0x80.
+        inline constexpr std::array<uint32_t, 256> braille_upper_lut{ braille_row_lut(0x01, 0x08) };
+        inline constexpr std::array<uint32_t, 256> braille_lower_lut{ braille_row_lut(0x40, 0x80) };
+
+        // Every braille cell, U+2800 to U+28FF, and every box drawing
+        // character used in the border is three UTF-8 bytes.
+        inline constexpr size_t utf8_cell_bytes{ 3 };
+
+        // Write the UTF-8 encoding of the braille cell U+2800 + dots.
+        constexpr auto write_braille(char *out, uint32_t dots) -> char *
+        {
+            out[0] = static_cast<char>(0xE2);
+            out[1] = static_cast<char>(0xA0 | (dots >> 6));
+            out[2] = static_cast<char>(0x80 | (dots & 0x3F));
+            return out + utf8_cell_bytes;
+        }
+
+        // Write one three byte UTF-8 character given as a string literal.
+        constexpr auto write_cell(char *out, char const (&cell)[utf8_cell_bytes + 1]) -> char *
+        {
+            return std::copy_n(cell, utf8_cell_bytes, out);
+        }
+
+        // The mask row feeding row r (0 to 3) of braille line `line`, or rows
+        // when it falls in the padding. Padding is split top and bottom.
+        constexpr auto braille_source_row(size_t rows, size_t line, size_t r) -> size_t
+        {
+            size_t const pad_top{ ((4 - (rows % 4)) % 4) / 2 };
+            size_t const padded_row{ (line * 4) + r };
+            return padded_row >= pad_top && padded_row - pad_top < rows ? padded_row - pad_top : rows;
+        }
+
+        // The shape of braille text: `lines` lines of `cells` braille cells,
+        // framed or not, newline separated with no trailing newline.
+        struct braille_layout
+        {
+            size_t lines;
+            size_t cells;
+            bool framed;
+
+            [[nodiscard]] constexpr auto text_lines() const -> size_t { return framed ? lines + 2 : lines; }
+            [[nodiscard]] constexpr auto line_bytes() const -> size_t { return ((framed ? cells + 2 : cells) * utf8_cell_bytes) + 1; }
+            [[nodiscard]] constexpr auto size() const -> size_t { return text_lines() == 0 ? 0 : (text_lines() * line_bytes()) - 1; }
+
+            // Write text line `text_line`, frame included, and its newline if
+            // it has one. write_line(out, line) writes the cells of a braille
+            // line and returns one past them.
+            template <typename WriteLine>
+            constexpr auto write(char *out, size_t text_line, WriteLine const &write_line) const -> char *
+            {
+                auto const write_bar = [&out, this](char const (&left)[utf8_cell_bytes + 1], char const (&right)[utf8_cell_bytes + 1])
+                    {
+                        out = write_cell(out, left);
+                        for (size_t c = 0; c < cells; ++c)
+                        {
+                            out = write_cell(out, "─");
+                        }
+
+                        out = write_cell(out, right);
+                    };
+
+                if (!framed)
+                {
+                    out = write_line(out, text_line);
+                }
+                else if (text_line == 0)
+                {
+                    write_bar("╭", "╮");
+                }
+                else if (text_line == lines + 1)
+                {
+                    write_bar("╰", "╯");
+                }
+                else
+                {
+                    out = write_cell(out, "│");
+                    out = write_line(out, text_line - 1);
+                    out = write_cell(out, "│");
+                }
+
+                if (text_line + 1 != text_lines())
+                {
+                    *out++ = '\n';
+                }
+
+                return out;
+            }
+        };
+
+        // Write all the text in one exactly sized buffer.
+        template <typename WriteLine>
+        auto braille_text(braille_layout const &layout, WriteLine const &write_line) -> std::string
+        {
+            std::string ret;
+            ret.resize_and_overwrite(
+                layout.size(),
+                [&](char *buffer, size_t)
+                {
+                    // libstdc++ 12 passes the capacity, not the requested size.
+                    char *out{ buffer };
+                    for (size_t text_line = 0; text_line < layout.text_lines(); ++text_line)
+                    {
+                        out = layout.write(out, text_line, write_line);
+                    }
+
+                    assert(out == buffer + layout.size());
+                    return layout.size();
+                });
+            return ret;
+        }
+
+        // Roughly how much text is encoded between flushes when streaming,
+        // and per task when encoding in parallel.
+        inline constexpr size_t braille_band_bytes{ size_t{ 64 } * 1024 };
+
+        // Write all the text in one exactly sized buffer, bands of lines in
+        // parallel. Every line has the same length, so each band knows where
+        // its text starts and writes straight into its slice.
+        template <typename WriteLine>
+        auto braille_text(std::execution::parallel_policy const &, braille_layout const &layout, WriteLine const &write_line) -> std::string
+        {
+            size_t const band_lines{ std::max<size_t>(1, braille_band_bytes / layout.line_bytes()) };
+            std::vector<size_t> bands((layout.text_lines() + band_lines - 1) / band_lines);
+            if (bands.size() < 2)
+            {
+                return braille_text(layout, write_line);
+            }
+
+            std::ranges::iota(bands, 0);
+            std::string ret;
+            ret.resize_and_overwrite(
+                layout.size(),
+                [&](char *buffer, size_t)
+                {
+                    std::for_each(
+                        std::execution::par,
+                        bands.begin(), bands.end(),
+                        [&layout, &write_line, buffer, band_lines](size_t band)
+                        {
+                            char *out{ buffer + (band * band_lines * layout.line_bytes()) };
+                            for (size_t text_line = band * band_lines; text_line < std::min((band + 1) * band_lines, layout.text_lines()); ++text_line)
+                            {
+                                out = layout.write(out, text_line, write_line);
+                            }
+                        });
+                    return layout.size();
+                });
+            return ret;
+        }
+
+        // Write the text a band of lines at a time into one reused buffer,
+        // handing each band to flush(std::string_view).
+        template <typename WriteLine, typename Flush>
+        auto stream_braille_text(braille_layout const &layout, WriteLine const &write_line, Flush &&flush) -> void
+        {
+            size_t const band_lines{ std::clamp<size_t>(braille_band_bytes / layout.line_bytes(), 1, std::max<size_t>(1, layout.text_lines())) };
+            std::string band(band_lines * layout.line_bytes(), '\0');
+            for (size_t first = 0; first < layout.text_lines(); first += band_lines)
+            {
+                char *out{ band.data() };
+                for (size_t text_line = first; text_line < std::min(first + band_lines, layout.text_lines()); ++text_line)
+                {
+                    out = layout.write(out, text_line, write_line);
+                }
+
+                flush(std::string_view{ band.data(), static_cast<size_t>(out - band.data()) });
+            }
+        }
+
+        // Write one line of braille cells built from four packed mask rows,
+        // any of which may be empty when it falls in the padding.
+        inline auto write_braille_line(char *out, std::array<std::span<uint64_t const>, 4> const &rows, size_t cells) -> char *
+        {
+            size_t const words{ (cells + 31) / 32 };
+            for (size_t w = 0; w < words; ++w)
+            {
+                std::array<uint64_t, 4> quad{};
+                for (size_t r = 0; r < 4; ++r)
+                {
+                    quad[r] = rows[r].empty() ? 0 : rows[r][w];
+                }
+
+                size_t const word_cells{ std::min<size_t>(32, cells - (w * 32)) };
+                for (size_t c = 0; c < word_cells; c += 4)
+                {
+                    size_t const shift{ c * 2 };
+                    uint32_t const four{
+                        braille_upper_lut[(quad[0] >> shift) & 0xFF] |
+                        (braille_upper_lut[(quad[1] >> shift) & 0xFF] << 1) |
+                        (braille_upper_lut[(quad[2] >> shift) & 0xFF] << 2) |
+                        braille_lower_lut[(quad[3] >> shift) & 0xFF] };
+                    for (size_t k = 0; k < std::min<size_t>(4, word_cells - c); ++k)
+                    {
+                        out = write_braille(out, (four >> (8 * k)) & 0xFF);
+                    }
+                }
+            }
+
+            return out;
+        }
+
+        // Write one line of braille cells built from four contiguous bool
+        // rows of cols pixels. Padding rows point at a row of false.
+        inline auto write_braille_line(char *out, std::array<bool const *, 4> const &rows, size_t cols) -> char *
+        {
+            auto const dots = [&rows](size_t col, uint32_t left, uint32_t right)
+                {
+                    return (static_cast<uint32_t>(rows[0][col]) * left) |
+                        (static_cast<uint32_t>(rows[1][col]) * (left << 1)) |
+                        (static_cast<uint32_t>(rows[2][col]) * (left << 2)) |
+                        (static_cast<uint32_t>(rows[3][col]) * right);
+                };
+
+            size_t col{ 0 };
+            for (; col + 1 < cols; col += 2)
+            {
+                out = write_braille(out, dots(col, 0x01, 0x40) | dots(col + 1, 0x08, 0x80));
+            }
+
+            if (col < cols)
+            {
+                out = write_braille(out, dots(col, 0x01, 0x40));
+            }
+
+            return out;
+        }
+
+        // Line writers: make a write_line(out, line) for each kind of mask.
+        inline auto braille_line_writer(bit_mask const &mask)
+        {
+            return [&mask](char *out, size_t line)
+                {
+                    std::array<std::span<uint64_t const>, 4> rows;
+                    for (size_t r = 0; r < 4; ++r)
+                    {
+                        if (size_t const row{ braille_source_row(mask.rows(), line, r) }; row != mask.rows())
+                        {
+                            rows[r] = mask.row(row);
+                        }
+                    }
+
+                    return write_braille_line(out, rows, (mask.cols() + 1) / 2);
+                };
+        }
+
+        template <contiguous_bool_mdspan MaskSpan>
+        auto braille_line_writer(MaskSpan const &mask)
+        {
+            // Padding rows read a row of false, which static widths need not
+            // allocate.
+            std::unique_ptr<bool[]> owned;
+            bool const *zeros{ nullptr };
+            if constexpr (MaskSpan::static_extent(1) != std::dynamic_extent)
+            {
+                zeros = false_row<MaskSpan::static_extent(1)>.data();
+            }
+            else
+            {
+                owned = std::make_unique<bool[]>(mask.extent(1));
+                zeros = owned.get();
+            }
+
+            return [&mask, owned = std::move(owned), zeros](char *out, size_t line)
+                {
+                    size_t const rows{ mask.extent(0) };
+                    size_t const cols{ mask.extent(1) };
+                    std::array<bool const *, 4> line_rows{};
+                    for (size_t r = 0; r < 4; ++r)
+                    {
+                        size_t const row{ braille_source_row(rows, line, r) };
+                        line_rows[r] = row == rows || cols == 0 ? zeros : mask.data_handle() + mask.mapping()(row, 0);
+                    }
+
+                    return write_braille_line(out, line_rows, cols);
+                };
+        }
+
+        // Reads any mask a pixel at a time, which also works in constant
+        // expressions.
+        template <bool_2d_mdspan MaskSpan>
+        constexpr auto pixel_line_writer(MaskSpan const &mask)
+        {
+            return [&mask](char *out, size_t line)
+                {
+                    size_t const rows{ mask.extent(0) };
+                    size_t const cols{ mask.extent(1) };
+                    for (size_t col = 0; col < cols; col += 2)
+                    {
+                        uint32_t dots{ 0 };
+                        for (size_t r = 0; r < 4; ++r)
+                        {
+                            size_t const row{ braille_source_row(rows, line, r) };
+                            if (row == rows)
+                            {
+                                continue;
+                            }
+
+                            uint32_t const left{ r == 3 ? 0x40U : 0x01U << r };
+                            uint32_t const right{ r == 3 ? 0x80U : 0x08U << r };
+                            dots |= mask[row, col] ? left : 0;
+                            dots |= col + 1 < cols && mask[row, col + 1] ? right : 0;
+                        }
+
+                        out = write_braille(out, dots);
+                    }
+
+                    return out;
+                };
+        }
+
+        template <bool_2d_mdspan MaskSpan>
+        auto braille_line_writer(MaskSpan const &mask)
+        {
+            return pixel_line_writer(mask);
+        }
+
+#if BRMA_POSIX_FD
+        // Write all of text to fd, retrying short and interrupted writes.
+        inline auto write_all(int fd, std::string_view text) -> void
+        {
+            while (!text.empty())
+            {
+                ssize_t const written{ ::write(fd, text.data(), text.size()) };
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    throw std::system_error(errno, std::generic_category(), "mask_braille_to");
+                }
+
+                text.remove_prefix(static_cast<size_t>(written));
+            }
+        }
+#endif
+
+        template <typename Mask>
+        auto braille_layout_of(Mask const &mask, border border) -> braille_layout
+        {
+            if constexpr (std::same_as<Mask, bit_mask>)
+            {
+                return { (mask.rows() + 3) / 4, (mask.cols() + 1) / 2, border == border::line };
+            }
+            else
+            {
+                return { (mask.extent(0) + 3) / 4, (mask.extent(1) + 1) / 2, border == border::line };
+            }
+        }
+
+        // Fill in the counts of an encode and hand the stats to the caller
+        // if it asked for them.
+        inline auto report_braille_stats(braille_stats &recorded, braille_layout const &layout, std::string const &text, braille_stats *stats) -> void
+        {
+            add_stat(recorded.lines, layout.text_lines());
+            add_stat(recorded.cells, layout.lines * layout.cells);
+            add_stat(recorded.bytes, text.size());
+            add_stat(recorded.allocations, text.capacity() > std::string{}.capacity() ? 1 : 0);
+            if (stats != nullptr)
+            {
+                *stats = recorded;
+            }
+        }
+
+        // Encode a mask the fast writer handles, timing the phases. An
+        // execution policy, if given, is passed on to braille_text.
+        template <typename Mask, typename... Policy>
+        auto encode_braille(Mask const &mask, border border, braille_stats *stats, Policy const &...policy) -> std::string
+        {
+            braille_stats recorded;
+            phase_timer layout_timer{ recorded.layout };
+            braille_layout const layout{ braille_layout_of(mask, border) };
+            auto const write_line{ braille_line_writer(mask) };
+            layout_timer.stop();
+
+            phase_timer encode_timer{ recorded.encode };
+            std::string ret{ braille_text(policy..., layout, write_line) };
+            encode_timer.stop();
+            report_braille_stats(recorded, layout, ret, stats);
+            return ret;
+        }
+    }
+
     /// Given a 2D mdspan of bool, return UTF8-encoded Braille text that has
     /// pips for every true value. Optionally includes a UTF8-encoded border.
     /// @param mask The mask to convert into a Braille-text based view of the
     ///     mask. This is any 2D mdspan of bool.
     /// @param border Whether to include a border.
+    /// @param stats If given, receives where the time went. See BRMA_STATS.
     /// @return A Braille-text version of the given mask.
     template <bool_2d_mdspan MaskSpan>
-    std::string mask_braille(MaskSpan const& mask, brma::border border = border::none)
+    std::string mask_braille(MaskSpan const& mask, brma::border border = border::none, braille_stats *stats = nullptr)
     {
-        size_t const mask_height = static_cast<int>(mask.extent(0));
-        size_t const mask_width = static_cast<int>(mask.extent(1));
-
-        size_t const required_pad_height = ((4 - (mask_height % 4)) % 4);
-        size_t const required_pad_width = (2 - (mask_width % 2)) % 2;
-        size_t const required_pad_top = required_pad_height / 2;
-        size_t const required_pad_left = required_pad_width / 2;
-
-        size_t const full_height = mask_height + required_pad_height;
-        size_t const full_width = mask_width + required_pad_width;
-
-        // define the padded mdspan
-        using padded_mdspan_t = std::mdspan<
-            const bool,
-            std::extents<std::size_t, std::dynamic_extent, std::dynamic_extent>,
-            std::layout_right,
-            detail::padded_bool_accessor<MaskSpan>
-        >;
-
-        // Construct padded_view
-        padded_mdspan_t padded_view{
-            mask.data_handle(),
-            std::extents{full_height, full_width},
-            detail::padded_bool_accessor<MaskSpan>{ mask, required_pad_top, required_pad_left }
-        };
+        // Plain row-major masks are encoded straight to UTF-8.
+        if constexpr (detail::contiguous_bool_mdspan<MaskSpan>)
+        {
+            return detail::encode_braille(mask, border, stats);
+        }
+        else
+        {
+            // Any other layout or accessor is read a pixel at a time.
+            braille_stats recorded;
+            detail::phase_timer layout_timer{ recorded.layout };
+            detail::braille_layout const layout{ detail::braille_layout_of(mask, border) };
+
+            size_t const mask_height = static_cast<size_t>(mask.extent(0));
+            size_t const mask_width = static_cast<size_t>(mask.extent(1));
+
+            size_t const required_pad_height = ((4 - (mask_height % 4)) % 4);
+            size_t const required_pad_width = (2 - (mask_width % 2)) % 2;
+            size_t const required_pad_top = required_pad_height / 2;
+            size_t const required_pad_left = required_pad_width / 2;
+
+            size_t const full_height = mask_height + required_pad_height;
+            size_t const full_width = mask_width + required_pad_width;
+
+            // define the padded mdspan
+            using padded_mdspan_t = std::mdspan<
+                const bool,
+                std::extents<std::size_t, std::dynamic_extent, std::dynamic_extent>,
+                std::layout_right,
+                detail::padded_bool_accessor<MaskSpan>
+            >;
+
+            // Construct padded_view
+            padded_mdspan_t padded_view{
+                nullptr, // the accessor reads through the mask itself
+                std::extents{full_height, full_width},
+                detail::padded_bool_accessor<MaskSpan>{ mask, required_pad_top, required_pad_left, full_width }
+            };
 
-        // Build Braille mdspan
-        using braille_mdspan_t = std::mdspan<
-            const uint32_t,
-            std::extents<std::size_t, std::dynamic_extent, std::dynamic_extent>,
-            std::layout_right,
-            detail::braille_accessor<padded_mdspan_t>
-        >;
+            // Build Braille mdspan
+            using braille_mdspan_t = std::mdspan<
+                const uint32_t,
+                std::extents<std::size_t, std::dynamic_extent, std::dynamic_extent>,
+                std::layout_right,
+                detail::braille_accessor<padded_mdspan_t>
+            >;
 
 
-        braille_mdspan_t const braille_view{
-            nullptr, // no backing storage needed
-            std::extents{full_height / 4, full_width / 2},
-            detail::braille_accessor{padded_view}
-        };
+            braille_mdspan_t const braille_view{
+                nullptr, // no backing storage needed
+                std::extents{full_height / 4, full_width / 2},
+                detail::braille_accessor{padded_view}
+            };
+
+            layout_timer.stop();
+
+            // The padding, cell building and joining are one lazy pipeline.
+            detail::phase_timer encode_timer{ recorded.encode };
+            std::string ret{ fmt::format("{}", fmt::join(border == brma::border::line ? detail::get_framed_braille_image_lines(braille_view) : detail::get_braille_image_lines(braille_view), "\n")) };
+            encode_timer.stop();
+            detail::report_braille_stats(recorded, layout, ret, stats);
+            return ret;
+        }
+    }
 
-        return fmt::format("{}", fmt::join(border == brma::border::line ? detail::get_framed_braille_image_lines(braille_view) : detail::get_braille_image_lines(braille_view), "\n"));
+    /// Given a bit-packed mask, return UTF8-encoded Braille text that has
+    /// pips for every set pixel. Optionally includes a UTF8-encoded border.
+    ///
+    /// Same output as the bool mdspan overload, but each braille cell is
+    /// formed from whole words with table lookups instead of reading its
+    /// eight pixels one at a time.
+    /// @param mask The mask to convert into a Braille-text based view.
+    /// @param border Whether to include a border.
+    /// @param stats If given, receives where the time went. See BRMA_STATS.
+    /// @return A Braille-text version of the given mask.
+    inline std::string mask_braille(bit_mask const& mask, brma::border border = border::none, braille_stats *stats = nullptr)
+    {
+        return detail::encode_braille(mask, border, stats);
+    }
+
+    /// The masks mask_braille_to and the parallel mask_braille can encode.
+    template <typename T>
+    concept braille_mask = bool_2d_mdspan<T> || std::same_as<T, bit_mask>;
+
+    /// Same text as the other mask_braille overloads, byte for byte, encoded
+    /// on all cores. Lines are split into bands that each write their slice
+    /// of one preallocated buffer, which pays off for large masks, such as
+    /// a 16k x 16k bitmap written to a file. Masks of a band or less are
+    /// encoded serially.
+    /// @param mask Any 2D mdspan of bool, or a bit_mask. Masks that are not
+    ///     row-major are read a pixel at a time.
+    /// @param border Whether to include a border.
+    /// @param stats If given, receives where the time went. See BRMA_STATS.
+    /// @return A Braille-text version of the given mask.
+    template <braille_mask Mask>
+    std::string mask_braille(std::execution::parallel_policy const &policy, Mask const& mask, brma::border border = border::none, braille_stats *stats = nullptr)
+    {
+        return detail::encode_braille(mask, border, stats, policy);
+    }
+
+    /// The length in bytes of the text mask_braille returns for a Rows x
+    /// Cols mask.
+    template <size_t Rows, size_t Cols, brma::border Border = border::none>
+    inline constexpr size_t braille_text_size{ detail::braille_layout{ (Rows + 3) / 4, (Cols + 1) / 2, Border == border::line }.size() };
+
+    /// Given a 2D mdspan of bool with static extents, return the text
+    /// mask_braille would, in an array sized at compile time. Nothing is
+    /// allocated and the call can be evaluated at compile time, so icons
+    /// known up front cost nothing at runtime:
+    ///
+    ///     constexpr auto icon{ brma::mask_braille_array<brma::border::line>(icon_mask) };
+    ///     std::string_view const text{ icon.data(), icon.size() };
+    ///
+    /// The text is not null terminated. The array lives on the stack, so
+    /// this suits small masks; use mask_braille or mask_braille_to for
+    /// large ones.
+    /// @tparam Border Whether to include a border.
+    /// @param mask The mask to convert into Braille text.
+    /// @return The UTF-8 Braille text.
+    template <brma::border Border = border::none, detail::static_bool_mdspan MaskSpan>
+    constexpr auto mask_braille_array(MaskSpan const& mask)
+        -> std::array<char, braille_text_size<MaskSpan::static_extent(0), MaskSpan::static_extent(1), Border>>
+    {
+        constexpr size_t rows{ MaskSpan::static_extent(0) };
+        constexpr size_t cols{ MaskSpan::static_extent(1) };
+        constexpr detail::braille_layout layout{ (rows + 3) / 4, (cols + 1) / 2, Border == border::line };
+        auto const write_line = [&mask](char *out, size_t line) -> char *
+            {
+                // At runtime row-major masks take the fast path, with padding
+                // rows reading a static row of false.
+                if !consteval
+                {
+                    if constexpr (detail::contiguous_bool_mdspan<MaskSpan>)
+                    {
+                        std::array<bool const *, 4> line_rows{};
+                        for (size_t r = 0; r < 4; ++r)
+                        {
+                            size_t const row{ detail::braille_source_row(rows, line, r) };
+                            line_rows[r] = row == rows || cols == 0 ? detail::false_row<cols>.data() : mask.data_handle() + mask.mapping()(row, 0);
+                        }
+
+                        return detail::write_braille_line(out, line_rows, cols);
+                    }
+                }
+
+                return detail::pixel_line_writer(mask)(out, line);
+            };
+
+        std::array<char, layout.size()> ret{};
+        char *out{ ret.data() };
+        for (size_t text_line = 0; text_line < layout.text_lines(); ++text_line)
+        {
+            out = layout.write(out, text_line, write_line);
+        }
+
+        return ret;
+    }
+
+    /// Write the text mask_braille would return to an output iterator a
+    /// band of lines at a time, so memory use does not grow with the mask.
+    /// @param out Where to write the UTF-8 bytes.
+    /// @param mask The mask to convert into Braille text.
+    /// @param border Whether to include a border.
+    /// @return The iterator past the last byte written.
+    template <std::output_iterator<char> Out, braille_mask Mask>
+    auto mask_braille_to(Out out, Mask const& mask, brma::border border = border::none) -> Out
+    {
+        detail::stream_braille_text(detail::braille_layout_of(mask, border), detail::braille_line_writer(mask),
+            [&out](std::string_view band) { out = std::ranges::copy(band, out).out; });
+        return out;
+    }
+
+    /// Write the text mask_braille would return to a stream a band of lines
+    /// at a time.
+    /// @return The stream.
+    template <braille_mask Mask>
+    auto mask_braille_to(std::ostream& stream, Mask const& mask, brma::border border = border::none) -> std::ostream&
+    {
+        detail::stream_braille_text(detail::braille_layout_of(mask, border), detail::braille_line_writer(mask),
+            [&stream](std::string_view band) { stream.write(band.data(), static_cast<std::streamsize>(band.size())); });
+        return stream;
+    }
+
+#if BRMA_POSIX_FD
+    /// Write the text mask_braille would return to a file descriptor a band
+    /// of lines at a time, straight from the encode buffer.
+    /// @throws std::system_error if a write fails.
+    template <braille_mask Mask>
+    auto mask_braille_to(int fd, Mask const& mask, brma::border border = border::none) -> void
+    {
+        detail::stream_braille_text(detail::braille_layout_of(mask, border), detail::braille_line_writer(mask),
+            [fd](std::string_view band) { detail::write_all(fd, band); });
     }
+#endif
 }
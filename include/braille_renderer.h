@@ -0,0 +1,175 @@
+#pragma once
+
+#include <braille_based_image.h>
+#include <cstddef>
+#include <cstring>
+#include <fmt/format.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace brma
+{
+    /// @brief Draws a sequence of masks to an ANSI terminal, sending only the
+    /// braille cells that changed since the previous frame.
+    ///
+    /// The first frame, and any frame whose size differs from the one before,
+    /// is drawn in full followed by a newline, like printing mask_braille.
+    /// Later frames move the cursor up into the drawn image with relative
+    /// cursor sequences, rewrite runs of changed cells, and return the cursor
+    /// to the line below the image. The border is only drawn with full frames.
+    /// Nothing else may be written to the terminal between frames, and the
+    /// image must fit on the screen for the relative moves to land.
+    class braille_renderer
+    {
+        brma::border border_;
+        detail::braille_layout layout_{ 0, 0, false };
+        bool drawn_{ false };
+        std::vector<char> previous_;
+        std::vector<char> current_;
+    public:
+        /// @brief Unchanged runs of at most this many cells between two
+        /// changes are rewritten rather than skipped with a cursor move,
+        /// which costs about as many bytes.
+        static constexpr size_t max_gap_cells{ 2 };
+
+        explicit braille_renderer(brma::border border = border::none) : border_{ border }
+        {
+        }
+
+        /// @brief Gets the bytes that bring the terminal from the previous
+        /// frame to this one. Empty when nothing changed.
+        template <braille_mask Mask>
+        auto frame(Mask const& mask) -> std::string
+        {
+            detail::braille_layout const layout{ detail::braille_layout_of(mask, border_) };
+            auto const write_line{ detail::braille_line_writer(mask) };
+            if (!drawn_ || layout.lines != layout_.lines || layout.cells != layout_.cells)
+            {
+                return redraw(layout, write_line);
+            }
+
+            size_t const line_bytes{ layout.cells * detail::utf8_cell_bytes };
+            char *out{ current_.data() };
+            for (size_t line = 0; line < layout.lines; ++line)
+            {
+                out = write_line(out, line);
+            }
+
+            std::string ret;
+            size_t cursor_row{ layout.text_lines() };
+            size_t const frame_offset{ layout.framed ? size_t{ 1 } : size_t{ 0 } };
+            for (size_t line = 0; line < layout.lines; ++line)
+            {
+                char const *now{ current_.data() + (line * line_bytes) };
+                char const *was{ previous_.data() + (line * line_bytes) };
+                auto const changed = [now, was](size_t cell)
+                    {
+                        return std::memcmp(now + (cell * detail::utf8_cell_bytes), was + (cell * detail::utf8_cell_bytes), detail::utf8_cell_bytes) != 0;
+                    };
+
+                for (size_t cell = 0; cell < layout.cells;)
+                {
+                    if (!changed(cell))
+                    {
+                        ++cell;
+                        continue;
+                    }
+
+                    // Extend the run while the next change is close enough.
+                    size_t last{ cell };
+                    for (size_t next = cell + 1; next < layout.cells && next <= last + max_gap_cells + 1; ++next)
+                    {
+                        if (changed(next))
+                        {
+                            last = next;
+                        }
+                    }
+
+                    move_to(ret, cursor_row, line + frame_offset, cell + frame_offset);
+                    ret.append(now + (cell * detail::utf8_cell_bytes), (last + 1 - cell) * detail::utf8_cell_bytes);
+                    cell = last + 1;
+                }
+            }
+
+            if (cursor_row != layout.text_lines())
+            {
+                ret.append(fmt::format("\x1b[{}E", layout.text_lines() - cursor_row));
+            }
+
+            std::swap(previous_, current_);
+            return ret;
+        }
+
+        /// @brief Writes the bytes that bring the terminal from the previous
+        /// frame to this one.
+        template <braille_mask Mask>
+        auto frame_to(std::ostream& stream, Mask const& mask) -> std::ostream&
+        {
+            std::string const bytes{ frame(mask) };
+            stream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            return stream.flush();
+        }
+
+        /// @brief Forgets the previous frame so the next one is drawn in full
+        /// below the cursor, for example after the screen was cleared.
+        auto reset() -> void
+        {
+            drawn_ = false;
+        }
+    private:
+        template <typename WriteLine>
+        auto redraw(detail::braille_layout const& layout, WriteLine const& write_line) -> std::string
+        {
+            std::string ret;
+            if (drawn_ && layout_.text_lines() != 0)
+            {
+                // Back to the top of the old image and clear it.
+                ret.append(fmt::format("\x1b[{}F\x1b[J", layout_.text_lines()));
+            }
+
+            ret.append(detail::braille_text(layout, write_line));
+            if (layout.text_lines() != 0)
+            {
+                ret.push_back('\n');
+            }
+
+            layout_ = layout;
+            drawn_ = true;
+            previous_.resize(layout.lines * layout.cells * detail::utf8_cell_bytes);
+            current_.resize(previous_.size());
+            char *out{ previous_.data() };
+            for (size_t line = 0; line < layout.lines; ++line)
+            {
+                out = write_line(out, line);
+            }
+
+            return ret;
+        }
+
+        // Move the cursor from text row `row` to (to_row, to_col), using
+        // relative sequences only.
+        static auto move_to(std::string& out, size_t& row, size_t to_row, size_t to_col) -> void
+        {
+            if (to_row < row)
+            {
+                out.append(fmt::format("\x1b[{}F", row - to_row));
+            }
+            else if (to_row > row)
+            {
+                out.append(fmt::format("\x1b[{}E", to_row - row));
+            }
+            else
+            {
+                out.push_back('\r');
+            }
+
+            if (to_col != 0)
+            {
+                out.append(fmt::format("\x1b[{}C", to_col));
+            }
+
+            row = to_row;
+        }
+    };
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit_mask.h>
+#include <cstdint>
+#include <execution>
+#include <numeric>
+#include <stippled_image.h>
+#include <vector>
+
+namespace brma
+{
+    /// @brief How a dither_renderer turns gray levels into dots.
+    enum class dither : uint8_t
+    {
+        /// @brief Error diffusion spreading all of a pixel's error to four
+        /// neighbours. Closest to the image's tones.
+        floyd_steinberg,
+        /// @brief Error diffusion spreading three quarters of a pixel's error
+        /// to six neighbours. Crisper, with clipped highlights and shadows.
+        atkinson,
+        /// @brief Thresholding against an 8x8 Bayer matrix. The fastest and
+        /// stable from frame to frame, with a visible cross-hatch.
+        ordered,
+    };
+
+    namespace detail
+    {
+        // The 8x8 Bayer matrix as thresholds in (0, 1).
+        constexpr auto bayer_thresholds() -> std::array<float, 64>
+        {
+            std::array<float, 64> ret{};
+            for (uint32_t i = 0; i < 8; ++i)
+            {
+                for (uint32_t j = 0; j < 8; ++j)
+                {
+                    // Interleave the bits of i ^ j and i, lowest bits weighing
+                    // most, so each 2x2 step is the pattern 0 2 / 3 1 and the
+                    // lowest ranks spread out over the whole matrix.
+                    uint32_t const x{ i ^ j };
+                    uint32_t rank{ 0 };
+                    for (uint32_t bit = 0; bit < 3; ++bit)
+                    {
+                        rank = (rank << 2) | (((x >> bit) & 1U) << 1) | ((i >> bit) & 1U);
+                    }
+
+                    ret[(i * 8) + j] = (static_cast<float>(rank) + 0.5f) / 64.0f;
+                }
+            }
+
+            return ret;
+        }
+
+        inline constexpr std::array<float, 64> bayer_8x8{ bayer_thresholds() };
+    }
+
+    /// @brief Renders gray images to dot masks by dithering, as a fast
+    /// alternative to stippling for live previews.
+    ///
+    /// Input values are in [0, 1] like the stippler's, and dots go where the
+    /// image is dark. The result is a bit_mask for mask_braille. The renderer
+    /// keeps its buffers between frames, so rendering a stream of same-sized
+    /// frames allocates nothing after the first.
+    ///
+    /// Error diffusion on large images runs as a wavefront: the image is cut
+    /// into blocks of block_cols columns, and block b of row i only needs
+    /// blocks up to b + 1 of the row above, so all blocks with the same
+    /// b + 2 * i run in parallel. The result is identical to the serial
+    /// scan. Ordered dithering has no dependencies and runs a row per task.
+    class dither_renderer
+    {
+        dither method_;
+        bool negate_;
+        std::vector<float> work_;
+        std::vector<size_t> tasks_;
+        bit_mask mask_;
+    public:
+        /// @brief The column block width of the diffusion wavefront. Whole
+        /// mask words, so blocks never share one.
+        static constexpr size_t block_cols{ 256 };
+
+        /// @brief Images with fewer pixels are diffused in one serial scan;
+        /// the wavefront's synchronization would cost more than it saves.
+        static constexpr size_t wavefront_pixels{ size_t{ 1 } << 18 };
+
+        /// @param negate Put dots where the image is bright instead.
+        explicit dither_renderer(dither method = dither::floyd_steinberg, bool negate = false)
+            : method_{ method }, negate_{ negate }
+        {
+        }
+
+        /// @brief Dithers a frame.
+        /// @return The dot mask, valid until the next frame.
+        template <float_2d_span Input>
+        auto render(Input input_img) -> bit_mask const &
+        {
+            size_t const rows{ input_img.extent(0) };
+            size_t const cols{ input_img.extent(1) };
+            if (mask_.rows() != rows || mask_.cols() != cols)
+            {
+                mask_ = bit_mask{ rows, cols };
+            }
+
+            if (rows == 0 || cols == 0)
+            {
+                return mask_;
+            }
+
+            if (method_ == dither::ordered)
+            {
+                ordered(input_img);
+                return mask_;
+            }
+
+            // Diffusion works on a copy that accumulates the error.
+            detail::init_energy(input_img, 1.0f, false, work_);
+            size_t const blocks{ (cols + block_cols - 1) / block_cols };
+            if (rows * cols < wavefront_pixels || blocks < 2)
+            {
+                for (size_t i = 0; i < rows; ++i)
+                {
+                    diffuse(i, 0, cols);
+                }
+
+                return mask_;
+            }
+
+            for (size_t step = 0; step < blocks + (2 * (rows - 1)); ++step)
+            {
+                // Block b of row i runs at step b + 2 * i.
+                size_t const first_row{ step < blocks ? 0 : ((step - blocks) / 2) + 1 };
+                size_t const last_row{ std::min(rows - 1, step / 2) };
+                tasks_.resize(last_row + 1 - first_row);
+                std::ranges::iota(tasks_, first_row);
+                std::for_each(
+                    std::execution::par,
+                    tasks_.begin(), tasks_.end(),
+                    [this, step, cols](size_t i)
+                    {
+                        size_t const block{ step - (2 * i) };
+                        diffuse(i, block * block_cols, std::min(cols, (block + 1) * block_cols));
+                    });
+            }
+
+            return mask_;
+        }
+
+        /// @brief Gets the last frame.
+        [[nodiscard]] auto stippled() const -> bit_mask::view_type { return mask_.view(); }
+
+        /// @brief Gets the bit-packed last frame.
+        [[nodiscard]] auto mask() const -> bit_mask const & { return mask_; }
+    private:
+        // Quantize columns [first, last) of row i, which must start on a mask
+        // word, and push their error to the pixels not yet quantized.
+        auto diffuse(size_t i, size_t first, size_t last) -> void
+        {
+            size_t const rows{ mask_.rows() };
+            size_t const cols{ mask_.cols() };
+            float *row{ work_.data() + (i * cols) };
+            float *below{ i + 1 < rows ? row + cols : nullptr };
+            float *below2{ i + 2 < rows ? row + (2 * cols) : nullptr };
+            std::span<uint64_t> const words{ mask_.row(i) };
+            uint64_t word{ 0 };
+            for (size_t j = first; j < last; ++j)
+            {
+                bool const ink{ row[j] < 0.5f };
+                float const error{ ink ? row[j] : row[j] - 1.0f };
+                word |= static_cast<uint64_t>(ink != negate_) << (j % 64);
+                if (j % 64 == 63 || j + 1 == last)
+                {
+                    words[j / 64] = word;
+                    word = 0;
+                }
+
+                if (method_ == dither::floyd_steinberg)
+                {
+                    if (j + 1 < cols)
+                    {
+                        row[j + 1] += error * (7.0f / 16.0f);
+                    }
+
+                    if (below != nullptr)
+                    {
+                        if (j > 0)
+                        {
+                            below[j - 1] += error * (3.0f / 16.0f);
+                        }
+
+                        below[j] += error * (5.0f / 16.0f);
+                        if (j + 1 < cols)
+                        {
+                            below[j + 1] += error * (1.0f / 16.0f);
+                        }
+                    }
+                }
+                else
+                {
+                    float const eighth{ error * 0.125f };
+                    for (size_t k = j + 1; k < std::min(cols, j + 3); ++k)
+                    {
+                        row[k] += eighth;
+                    }
+
+                    if (below != nullptr)
+                    {
+                        for (size_t k = j == 0 ? 0 : j - 1; k < std::min(cols, j + 2); ++k)
+                        {
+                            below[k] += eighth;
+                        }
+                    }
+
+                    if (below2 != nullptr)
+                    {
+                        below2[j] += eighth;
+                    }
+                }
+            }
+        }
+
+        template <float_2d_span Input>
+        auto ordered(Input const &input_img) -> void
+        {
+            size_t const cols{ mask_.cols() };
+            tasks_.resize(mask_.rows());
+            std::ranges::iota(tasks_, 0);
+            std::for_each(
+                std::execution::par,
+                tasks_.begin(), tasks_.end(),
+                [this, &input_img, cols](size_t i)
+                {
+                    float const *thresholds{ detail::bayer_8x8.data() + ((i % 8) * 8) };
+                    std::span<uint64_t> const words{ mask_.row(i) };
+                    for (size_t w = 0; w < words.size(); ++w)
+                    {
+                        uint64_t word{ 0 };
+                        for (size_t j = w * 64; j < std::min(cols, (w + 1) * 64); ++j)
+                        {
+                            word |= static_cast<uint64_t>((input_img[i, j] < thresholds[j % 8]) != negate_) << (j % 64);
+                        }
+
+                        words[w] = word;
+                    }
+                });
+        }
+    };
+}
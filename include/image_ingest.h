@@ -0,0 +1,332 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <limits>
+#include <mdspan>
+#include <numeric>
+#include <simd_kernels.h>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace brma
+{
+    /// @brief A 2D gray or 3D channels-last mdspan over 8 or 16 bit pixels,
+    /// with any layout. Three or four channels are RGB(A); one or two are
+    /// gray, with alpha ignored.
+    template <typename M>
+    concept pixel_span = requires(M m)
+    {
+        requires std::same_as<std::remove_const_t<typename M::element_type>, uint8_t> ||
+                 std::same_as<std::remove_const_t<typename M::element_type>, uint16_t>;
+        requires M::rank() == 2 || M::rank() == 3;
+    };
+
+    namespace detail
+    {
+        // Separable resampling weights from a source axis to a destination
+        // axis: destination k is the sum of weights[offset[k] + t] times
+        // source first[k] + t, for t < size(k). The filter is a tent as wide
+        // as a destination pixel, and at least as wide as a source pixel, so
+        // shrinking averages like a box and enlarging interpolates linearly.
+        // Weights are positive and sum to one.
+        struct resample_taps
+        {
+            std::vector<size_t> first;
+            std::vector<size_t> offset;
+            std::vector<float> weights;
+            // The most destinations any one source index feeds.
+            size_t max_overlap{ 0 };
+
+            [[nodiscard]] auto size(size_t k) const -> size_t { return offset[k + 1] - offset[k]; }
+            [[nodiscard]] auto end(size_t k) const -> size_t { return first[k] + size(k); }
+
+            auto reset(size_t source, size_t destination) -> void
+            {
+                first.clear();
+                offset.assign(1, 0);
+                weights.clear();
+                std::vector<ptrdiff_t> feeds(source + 1, 0);
+                std::vector<double> raw;
+                double const scale{ static_cast<double>(source) / static_cast<double>(destination) };
+                double const support{ std::max(scale, 1.0) };
+                for (size_t k = 0; k < destination; ++k)
+                {
+                    double const center{ (static_cast<double>(k) + 0.5) * scale };
+                    auto const lo{ static_cast<size_t>(std::max(0.0, std::floor(center - support + 0.5))) };
+                    size_t const hi{ std::min(source, static_cast<size_t>(std::max(0.0, std::floor(center + support + 0.5)))) };
+                    // The nearest source center is within half a pixel, so
+                    // there is always a weight.
+                    size_t lowest{ hi };
+                    double total{ 0.0 };
+                    raw.clear();
+                    for (size_t s = lo; s < hi; ++s)
+                    {
+                        double const w{ 1.0 - (std::abs(static_cast<double>(s) + 0.5 - center) / support) };
+                        if (w > 0.0)
+                        {
+                            lowest = std::min(lowest, s);
+                            raw.push_back(w);
+                            total += w;
+                        }
+                    }
+
+                    // Normalize in double, round once
+                    for (double const w : raw)
+                    {
+                        weights.push_back(static_cast<float>(w / total));
+                    }
+
+                    first.push_back(lowest);
+                    offset.push_back(weights.size());
+                    ++feeds[lowest];
+                    --feeds[end(k)];
+                }
+
+                max_overlap = 0;
+                ptrdiff_t active{ 0 };
+                for (ptrdiff_t const change : feeds)
+                {
+                    active += change;
+                    max_overlap = std::max(max_overlap, static_cast<size_t>(active));
+                }
+            }
+        };
+    }
+
+    /// @brief Turns 8 or 16 bit gray or RGB pixels into the float image the
+    /// stippler takes, in one pass over the source.
+    ///
+    /// Output rows are split into bands that run in parallel. A band reads
+    /// each source row it covers once, takes its luma (Rec. 601, like CImg's
+    /// YCbCr) and adds it, weighted, into the accumulators of the few output
+    /// rows it feeds with the vector kernels. An output row is resampled
+    /// across as soon as its last source row is in. Normalizing to [0, 1] by
+    /// the image's range then takes one pass over the output, which is
+    /// usually much smaller than the source. Buffers are kept, so ingesting
+    /// a stream of same-sized frames allocates nothing after the first.
+    class image_ingest
+    {
+        size_t rows_;
+        size_t cols_;
+        bool normalize_;
+        size_t max_bands_;
+        size_t source_rows_{ 0 };
+        size_t source_cols_{ 0 };
+        detail::resample_taps row_taps_;
+        detail::resample_taps col_taps_;
+        std::vector<float> image_;
+        // Per band: a source-wide luma row and a ring of accumulators.
+        std::vector<float> scratch_;
+        std::vector<std::pair<float, float>> band_ranges_;
+        std::vector<size_t> tasks_;
+    public:
+        /// @brief The fewest output rows a band is given.
+        static constexpr size_t band_rows{ 16 };
+
+        /// @brief Output ranges up to this wide are not stretched by
+        /// normalizing: less than one 16 bit level.
+        static constexpr float flat_range{ 1e-5f };
+
+        /// @param rows, cols The output size. When both are 0 the source
+        ///     size is kept, when one is 0 it follows the source's aspect.
+        /// @param normalize Stretch the output to span [0, 1]. Otherwise
+        ///     pixels are divided by the format's maximum.
+        /// @param max_bands The most bands the output rows are split into, 1
+        ///     for a serial pass. 0 picks enough to keep every core busy. The
+        ///     output is the same whatever the count.
+        explicit image_ingest(size_t rows = 0, size_t cols = 0, bool normalize = true, size_t max_bands = 0)
+            : rows_{ rows }, cols_{ cols }, normalize_{ normalize }, max_bands_{ max_bands }
+        {
+        }
+
+        /// @brief Converts a frame.
+        /// @return The gray image, valid until the next frame.
+        template <pixel_span Pixels>
+        auto ingest(Pixels pixels) -> std::mdspan<float, std::dextents<size_t, 2>>
+        {
+            size_t const source_rows{ pixels.extent(0) };
+            size_t const source_cols{ pixels.extent(1) };
+            auto const [rows, cols] = output_size(source_rows, source_cols);
+            if (source_rows == 0 || source_cols == 0 || rows == 0 || cols == 0)
+            {
+                image_.clear();
+                return image();
+            }
+
+            if (source_rows != source_rows_ || source_cols != source_cols_ || rows != row_taps_.first.size() || cols != col_taps_.first.size())
+            {
+                source_rows_ = source_rows;
+                source_cols_ = source_cols;
+                row_taps_.reset(source_rows, rows);
+                col_taps_.reset(source_cols, cols);
+            }
+
+            // Enough bands to keep every core busy, but few enough that
+            // their scratch stays small.
+            size_t const bands{ std::min((rows + band_rows - 1) / band_rows, max_bands_ != 0 ? max_bands_ : 4 * std::max<size_t>(1, std::thread::hardware_concurrency())) };
+            image_.resize(rows * cols);
+            scratch_.resize(bands * (row_taps_.max_overlap + 1) * source_cols);
+            band_ranges_.resize(bands);
+            tasks_.resize(bands);
+            std::ranges::iota(tasks_, 0);
+            float const unit{ 1.0f / static_cast<float>(std::numeric_limits<std::remove_const_t<typename Pixels::element_type>>::max()) };
+            std::for_each(
+                std::execution::par,
+                tasks_.begin(), tasks_.end(),
+                [this, &pixels, rows, cols, bands, unit](size_t band)
+                {
+                    band_ranges_[band] = resample_band(pixels, band * rows / bands, (band + 1) * rows / bands, cols, band, unit);
+                });
+
+            if (normalize_)
+            {
+                auto [lo, hi] = band_ranges_.front();
+                for (auto const &[band_lo, band_hi] : band_ranges_)
+                {
+                    lo = std::min(lo, band_lo);
+                    hi = std::max(hi, band_hi);
+                }
+
+                // A flat image has no range to stretch; it stays as it is.
+                // Resampling rounds a flat image's rows apart by a few ulps,
+                // so a range under a 16 bit level counts as flat.
+                if (hi - lo > flat_range)
+                {
+                    float const stretch{ 1.0f / (hi - lo) };
+                    std::for_each(
+                        std::execution::par,
+                        tasks_.begin(), tasks_.end(),
+                        [this, rows, cols, bands, lo, stretch](size_t band)
+                        {
+                            float *const first{ image_.data() + (band * rows / bands * cols) };
+                            float *const last{ image_.data() + ((band + 1) * rows / bands * cols) };
+                            std::transform(first, last, first, [lo, stretch](float v) { return (v - lo) * stretch; });
+                        });
+                }
+            }
+
+            return image();
+        }
+
+        /// @brief Gets the last frame.
+        [[nodiscard]] auto image() -> std::mdspan<float, std::dextents<size_t, 2>>
+        {
+            size_t const rows{ image_.empty() ? 0 : row_taps_.first.size() };
+            size_t const cols{ image_.empty() ? 0 : col_taps_.first.size() };
+            return std::mdspan<float, std::dextents<size_t, 2>>{ image_.data(), rows, cols };
+        }
+    private:
+        [[nodiscard]] auto output_size(size_t source_rows, size_t source_cols) const -> std::pair<size_t, size_t>
+        {
+            if (rows_ == 0 && cols_ == 0)
+            {
+                return { source_rows, source_cols };
+            }
+
+            if (rows_ == 0)
+            {
+                return { source_cols == 0 ? 0 : std::max<size_t>(1, ((source_rows * cols_) + (source_cols / 2)) / source_cols), cols_ };
+            }
+
+            if (cols_ == 0)
+            {
+                return { rows_, source_rows == 0 ? 0 : std::max<size_t>(1, ((source_cols * rows_) + (source_rows / 2)) / source_rows) };
+            }
+
+            return { rows_, cols_ };
+        }
+
+        // The luma of source row i, in the format's units.
+        template <pixel_span Pixels>
+        static auto luma_row(Pixels const &pixels, size_t i, float *luma) -> void
+        {
+            size_t const cols{ pixels.extent(1) };
+            if constexpr (Pixels::rank() == 2)
+            {
+                for (size_t j = 0; j < cols; ++j)
+                {
+                    luma[j] = static_cast<float>(pixels[i, j]);
+                }
+            }
+            else if (pixels.extent(2) < 3)
+            {
+                for (size_t j = 0; j < cols; ++j)
+                {
+                    luma[j] = static_cast<float>(pixels[i, j, 0]);
+                }
+            }
+            else
+            {
+                for (size_t j = 0; j < cols; ++j)
+                {
+                    luma[j] = (0.299f * static_cast<float>(pixels[i, j, 0])) +
+                              (0.587f * static_cast<float>(pixels[i, j, 1])) +
+                              (0.114f * static_cast<float>(pixels[i, j, 2]));
+                }
+            }
+        }
+
+        // Fill output rows [first_row, last_row) and return their range.
+        // Rows are opened in order as their first source row comes up and
+        // finished in order after their last, so the open ones are
+        // consecutive and fit a ring of max_overlap accumulators.
+        template <pixel_span Pixels>
+        auto resample_band(Pixels const &pixels, size_t first_row, size_t last_row, size_t cols, size_t band, float unit) -> std::pair<float, float>
+        {
+            auto const &kernels{ detail::simd::active() };
+            size_t const source_cols{ pixels.extent(1) };
+            size_t const ring{ row_taps_.max_overlap };
+            float *const luma{ scratch_.data() + (band * (ring + 1) * source_cols) };
+            float *const sums{ luma + source_cols };
+            float lo{ std::numeric_limits<float>::infinity() };
+            float hi{ -std::numeric_limits<float>::infinity() };
+            size_t opened{ first_row };
+            size_t finished{ first_row };
+            for (size_t s = row_taps_.first[first_row]; finished < last_row; ++s)
+            {
+                luma_row(pixels, s, luma);
+                for (; opened < last_row && row_taps_.first[opened] <= s; ++opened)
+                {
+                    std::fill_n(sums + ((opened % ring) * source_cols), source_cols, 0.0f);
+                }
+
+                for (size_t i = finished; i < opened; ++i)
+                {
+                    if (s < row_taps_.end(i))
+                    {
+                        kernels.add_scaled(sums + ((i % ring) * source_cols), luma, row_taps_.weights[row_taps_.offset[i] + (s - row_taps_.first[i])], source_cols);
+                    }
+                }
+
+                for (; finished < opened && row_taps_.end(finished) <= s + 1; ++finished)
+                {
+                    float const *const sum{ sums + ((finished % ring) * source_cols) };
+                    float *const out{ image_.data() + (finished * cols) };
+                    for (size_t j = 0; j < cols; ++j)
+                    {
+                        float const *const source{ sum + col_taps_.first[j] };
+                        float const *const weights{ col_taps_.weights.data() + col_taps_.offset[j] };
+                        float v{ 0.0f };
+                        for (size_t t = 0; t < col_taps_.size(j); ++t)
+                        {
+                            v += source[t] * weights[t];
+                        }
+
+                        out[j] = v * unit;
+                        lo = std::min(lo, out[j]);
+                        hi = std::max(hi, out[j]);
+                    }
+                }
+            }
+
+            return { lo, hi };
+        }
+    };
+}
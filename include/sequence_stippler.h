@@ -0,0 +1,355 @@
+#pragma once
+
+#include <algorithm>
+#include <bit_mask.h>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stippled_image.h>
+#include <vector>
+
+namespace brma
+{
+    /// @brief Stipples a sequence of frames, such as video, carrying the
+    /// samples from one frame to the next.
+    ///
+    /// The first frame, or a frame of a new size, is stippled from scratch
+    /// exactly as the windowed stippler does. After that only pixels that
+    /// changed by more than change_threshold update the energy. Samples near
+    /// them are relaxed void-and-cluster style: the sample in the tightest
+    /// cluster moves to the largest void until a removed sample's void is its
+    /// own spot again. Samples away from the changes stay put, so the result
+    /// does not flicker and each frame costs a scan of the frame plus work
+    /// proportional to how much of it moved.
+    ///
+    /// With window_sigmas <= 0, or an image too small for a window, there is
+    /// no local update to make and every frame is stippled from scratch.
+    class sequence_stippler
+    {
+        float percentage_;
+        float sigma_;
+        float content_bias_;
+        bool negate_;
+        float window_sigmas_;
+        float change_threshold_;
+        size_t rows_{ 0 };
+        size_t cols_{ 0 };
+        size_t radius_{ 0 };
+        std::vector<float> window_;
+        std::vector<float> neg_window_;
+        std::vector<float> image_;
+        // Occupied pixels are infinite.
+        std::vector<float> energy_;
+        // Minus the energy an occupied pixel would have without its own
+        // sample, for samples in dirty blocks. Infinite everywhere else, so
+        // the minimum is the tightest cluster.
+        std::vector<float> cluster_;
+        std::optional<detail::min_index> energy_min_;
+        std::optional<detail::min_index> cluster_min_;
+        std::vector<uint8_t> dirty_;
+        std::vector<size_t> dirty_blocks_;
+        bit_mask mask_;
+        std::vector<uint32_t> sample_rows_;
+        std::vector<uint32_t> sample_cols_;
+        std::vector<float> sample_values_;
+        size_t moved_{ 0 };
+
+        static constexpr size_t block_size{ 16 };
+    public:
+        /// @brief Makes a sequence stippler. The parameters are the same as
+        /// the stippler's.
+        /// @param change_threshold How much a pixel must change, relative to
+        ///     the value last used for it, before the stipple reacts.
+        explicit sequence_stippler(
+            float percentage = 0.33f,
+            float sigma = 0.9f,
+            float content_bias = 0.5f,
+            bool negate = false,
+            float window_sigmas = 4.0f,
+            float change_threshold = 0.02f)
+            : percentage_{ percentage }, sigma_{ sigma }, content_bias_{ content_bias }, negate_{ negate },
+              window_sigmas_{ window_sigmas }, change_threshold_{ change_threshold }
+        {
+        }
+
+        /// @brief Stipples the next frame.
+        template <float_2d_span Input>
+        auto next(Input input_img) -> void
+        {
+            size_t const rows{ input_img.extent(0) };
+            size_t const cols{ input_img.extent(1) };
+            if (rows != rows_ || cols != cols_ || radius_ == 0)
+            {
+                restart(input_img);
+                collect_samples();
+                return;
+            }
+
+            // Take the changed pixels into the energy and dirty the blocks
+            // whose samples can feel them.
+            float const scale{ negate_ ? -content_bias_ : content_bias_ };
+            for (size_t i = 0; i < rows_; ++i)
+            {
+                for (size_t j = 0; j < cols_; ++j)
+                {
+                    float &old_value{ image_[(i * cols_) + j] };
+                    float const value{ input_img[i, j] };
+                    if (std::abs(value - old_value) <= change_threshold_)
+                    {
+                        continue;
+                    }
+
+                    float &energy{ energy_[(i * cols_) + j] };
+                    if (energy != std::numeric_limits<float>::infinity())
+                    {
+                        energy += (value - old_value) * scale;
+                        energy_min_->update(i, j, j + 1);
+                    }
+
+                    old_value = value;
+                    mark_dirty_around(i, j);
+                    // A block dirtied earlier in the scan holds the cluster
+                    // energy from before this change.
+                    if (occupied(i, j))
+                    {
+                        cluster_[(i * cols_) + j] = -energy_without(i, j);
+                        cluster_min_->update(i, j, j + 1);
+                    }
+                }
+            }
+
+            relax();
+            collect_samples();
+        }
+
+        /// @brief Gets how many samples the last frame moved.
+        [[nodiscard]] auto moved() const -> size_t { return moved_; }
+
+        /// @brief Gets the stippled frame.
+        [[nodiscard]] auto stippled() const -> bit_mask::view_type { return mask_.view(); }
+
+        /// @brief Gets the bit-packed stippled frame.
+        [[nodiscard]] auto mask() const -> bit_mask const & { return mask_; }
+
+        /// @brief Gets the samples of the stippled frame, row-major, valid
+        /// until the next frame.
+        [[nodiscard]] auto samples() const -> sample_spans { return { sample_rows_, sample_cols_, sample_values_ }; }
+    private:
+        auto collect_samples() -> void
+        {
+            sample_rows_.clear();
+            sample_cols_.clear();
+            sample_values_.clear();
+            for (size_t i = 0; i < rows_; ++i)
+            {
+                for (size_t j = 0; j < cols_; ++j)
+                {
+                    if (occupied(i, j))
+                    {
+                        sample_rows_.push_back(static_cast<uint32_t>(i));
+                        sample_cols_.push_back(static_cast<uint32_t>(j));
+                        sample_values_.push_back(image_[(i * cols_) + j]);
+                    }
+                }
+            }
+        }
+
+        template <float_2d_span Input>
+        auto restart(Input input_img) -> void
+        {
+            rows_ = input_img.extent(0);
+            cols_ = input_img.extent(1);
+            radius_ = detail::window_radius(rows_, cols_, sigma_, window_sigmas_);
+            moved_ = 0;
+            image_.resize(rows_ * cols_);
+            for (size_t i = 0; i < rows_; ++i)
+            {
+                for (size_t j = 0; j < cols_; ++j)
+                {
+                    image_[(i * cols_) + j] = input_img[i, j];
+                }
+            }
+
+            if (radius_ == 0)
+            {
+                // No energy is kept, so occupied() reads the mask.
+                mask_ = stippler{ input_img, percentage_, sigma_, content_bias_, negate_, window_sigmas_ }.finish().mask;
+                energy_.clear();
+                return;
+            }
+
+            window_ = detail::splat_window(sigma_, radius_);
+            neg_window_.resize(window_.size());
+            std::ranges::transform(window_, neg_window_.begin(), [](float w) { return -w; });
+            neg_window_[neg_window_.size() / 2] = 0.0f;
+            energy_ = detail::init_energy(input_img, content_bias_, negate_);
+            cluster_.assign(rows_ * cols_, std::numeric_limits<float>::infinity());
+            energy_min_.emplace(energy_.data(), rows_, cols_, cols_);
+            cluster_min_.emplace(cluster_.data(), rows_, cols_, cols_);
+            dirty_.assign(((rows_ + block_size - 1) / block_size) * ((cols_ + block_size - 1) / block_size), 0);
+            dirty_blocks_.clear();
+            mask_ = bit_mask{ rows_, cols_, negate_ };
+
+            auto const sample_count{ static_cast<size_t>(static_cast<float>(rows_ * cols_) * percentage_) };
+            for (size_t s = 0; s < sample_count; ++s)
+            {
+                auto const [x, y] = energy_min_->argmin();
+                add_sample(x, y);
+            }
+        }
+
+        [[nodiscard]] auto occupied(size_t i, size_t j) const -> bool
+        {
+            return energy_.empty() ? mask_[i, j] != negate_ : energy_[(i * cols_) + j] == std::numeric_limits<float>::infinity();
+        }
+
+        auto add_sample(size_t x, size_t y) -> void
+        {
+            float const energy{ energy_[(x * cols_) + y] };
+            detail::add_window(energy_.data(), rows_, cols_, window_, x, y, radius_);
+            detail::add_window(cluster_.data(), rows_, cols_, neg_window_, x, y, radius_);
+            if (dirty_[block_of(x, y)] != 0)
+            {
+                cluster_[(x * cols_) + y] = -energy;
+            }
+
+            detail::update_window(*energy_min_, rows_, cols_, x, y, radius_);
+            detail::update_window(*cluster_min_, rows_, cols_, x, y, radius_);
+            mask_.set(x, y, !negate_);
+        }
+
+        auto remove_sample(size_t x, size_t y) -> void
+        {
+            float const energy{ -cluster_[(x * cols_) + y] };
+            detail::add_window(energy_.data(), rows_, cols_, neg_window_, x, y, radius_);
+            detail::add_window(cluster_.data(), rows_, cols_, window_, x, y, radius_);
+            energy_[(x * cols_) + y] = energy;
+            detail::update_window(*energy_min_, rows_, cols_, x, y, radius_);
+            detail::update_window(*cluster_min_, rows_, cols_, x, y, radius_);
+            mask_.set(x, y, negate_);
+        }
+
+        // The energy at occupied (x, y) without its own sample, rebuilt from
+        // the image and the samples around it.
+        [[nodiscard]] auto energy_without(size_t x, size_t y) const -> float
+        {
+            size_t const width{ (2 * radius_) + 1 };
+            float ret{ image_[(x * cols_) + y] * content_bias_ * (negate_ ? -1.0f : 1.0f) };
+            for (size_t di = 0; di < width; ++di)
+            {
+                size_t const i{ (x + rows_ + di - radius_) % rows_ };
+                for (size_t dj = 0; dj < width; ++dj)
+                {
+                    size_t const j{ (y + cols_ + dj - radius_) % cols_ };
+                    if ((di != radius_ || dj != radius_) && occupied(i, j))
+                    {
+                        ret += window_[(di * width) + dj];
+                    }
+                }
+            }
+
+            return ret;
+        }
+
+        [[nodiscard]] auto block_of(size_t i, size_t j) const -> size_t
+        {
+            return ((i / block_size) * ((cols_ + block_size - 1) / block_size)) + (j / block_size);
+        }
+
+        // Dirty every block within radius of (i, j), stepping through the
+        // window a block at a time so no block is skipped.
+        auto mark_dirty_around(size_t i, size_t j) -> void
+        {
+            for (size_t di = 0;; di = std::min(di + block_size, 2 * radius_))
+            {
+                for (size_t dj = 0;; dj = std::min(dj + block_size, 2 * radius_))
+                {
+                    mark_dirty(block_of((i + rows_ + di - radius_) % rows_, (j + cols_ + dj - radius_) % cols_));
+                    if (dj == 2 * radius_)
+                    {
+                        break;
+                    }
+                }
+
+                if (di == 2 * radius_)
+                {
+                    break;
+                }
+            }
+        }
+
+        // Start tracking the clusters of a block's samples.
+        auto mark_dirty(size_t block) -> void
+        {
+            if (dirty_[block] != 0)
+            {
+                return;
+            }
+
+            dirty_[block] = 1;
+            dirty_blocks_.push_back(block);
+            size_t const blocks_per_row{ (cols_ + block_size - 1) / block_size };
+            size_t const row0{ (block / blocks_per_row) * block_size };
+            size_t const col0{ (block % blocks_per_row) * block_size };
+            size_t const col1{ std::min(col0 + block_size, cols_) };
+            for (size_t i = row0; i < std::min(row0 + block_size, rows_); ++i)
+            {
+                for (size_t j = col0; j < col1; ++j)
+                {
+                    if (occupied(i, j))
+                    {
+                        cluster_[(i * cols_) + j] = -energy_without(i, j);
+                    }
+                }
+
+                cluster_min_->update(i, col0, col1);
+            }
+        }
+
+        // Move samples from the tightest dirty cluster to the largest void
+        // until a removed sample would go straight back, then forget the
+        // dirty blocks.
+        auto relax() -> void
+        {
+            moved_ = 0;
+            size_t const max_moves{ (dirty_blocks_.size() * block_size * block_size) + 1 };
+            while (moved_ < max_moves)
+            {
+                auto const [cx, cy] = cluster_min_->argmin();
+                if (cluster_[(cx * cols_) + cy] == std::numeric_limits<float>::infinity())
+                {
+                    break;
+                }
+
+                remove_sample(cx, cy);
+                auto const [vx, vy] = energy_min_->argmin();
+                if (vx == cx && vy == cy)
+                {
+                    add_sample(cx, cy);
+                    break;
+                }
+
+                mark_dirty(block_of(vx, vy));
+                add_sample(vx, vy);
+                ++moved_;
+            }
+
+            size_t const blocks_per_row{ (cols_ + block_size - 1) / block_size };
+            for (size_t block : dirty_blocks_)
+            {
+                dirty_[block] = 0;
+                size_t const row0{ (block / blocks_per_row) * block_size };
+                size_t const col0{ (block % blocks_per_row) * block_size };
+                size_t const col1{ std::min(col0 + block_size, cols_) };
+                for (size_t i = row0; i < std::min(row0 + block_size, rows_); ++i)
+                {
+                    std::fill(cluster_.begin() + static_cast<ptrdiff_t>((i * cols_) + col0), cluster_.begin() + static_cast<ptrdiff_t>((i * cols_) + col1), std::numeric_limits<float>::infinity());
+                    cluster_min_->update(i, col0, col1);
+                }
+            }
+
+            dirty_blocks_.clear();
+        }
+    };
+}
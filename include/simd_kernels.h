@@ -0,0 +1,524 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BRMA_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#else
+#define BRMA_SIMD_X86 0
+#endif
+
+// GCC and clang only emit vector instructions the function was compiled for,
+// MSVC emits whatever intrinsic it is given.
+#if BRMA_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define BRMA_SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BRMA_SIMD_TARGET(isa)
+#endif
+
+// GCC fuses a multiply and an add into one FMA whenever the target has it,
+// which rounds once instead of twice. Kernels that multiply and add opt out,
+// so every instruction set rounds the same. Clang only fuses within one
+// expression, and MSVC not at all by default.
+#if defined(__GNUC__) && !defined(__clang__)
+#define BRMA_SIMD_NO_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+#define BRMA_SIMD_NO_CONTRACT
+#endif
+
+namespace brma::detail::simd
+{
+    /// @brief Instruction sets the stippling kernels are written for.
+    enum class isa : uint8_t
+    {
+        scalar,
+        sse4_2,
+        avx2,
+        avx512,
+    };
+
+    /// @brief The stippling inner loops. Every implementation does the same
+    /// float operations in the same order per element as the scalar one, so
+    /// results are bit-for-bit identical whatever instruction set runs them.
+    struct kernels
+    {
+        /// dst[i] += src[i]
+        void (*add)(float *dst, float const *src, size_t n);
+
+        /// Index of the first minimum of values[0, n), like std::min_element.
+        size_t (*min_element)(float const *values, size_t n);
+
+        /// dst[i] += src[i], then the index of the first minimum of dst.
+        /// Reads dst once instead of once for the add and once for the scan.
+        size_t (*add_min)(float *dst, float const *src, size_t n);
+
+        /// dst[i] = src[i] * a * b, multiplied left to right.
+        void (*scale)(float *dst, float const *src, float a, float b, size_t n);
+
+        /// dst[i] += src[i] * a
+        void (*add_scaled)(float *dst, float const *src, float a, size_t n);
+    };
+
+    namespace scalar
+    {
+        inline auto add(float *dst, float const *src, size_t n) -> void
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                dst[i] += src[i];
+            }
+        }
+
+        inline auto min_element(float const *values, size_t n) -> size_t
+        {
+            size_t best = 0;
+            for (size_t i = 1; i < n; ++i)
+            {
+                if (values[i] < values[best])
+                {
+                    best = i;
+                }
+            }
+
+            return best;
+        }
+
+        inline auto add_min(float *dst, float const *src, size_t n) -> size_t
+        {
+            size_t best = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                dst[i] += src[i];
+                if (dst[i] < dst[best])
+                {
+                    best = i;
+                }
+            }
+
+            return best;
+        }
+
+        inline auto scale(float *dst, float const *src, float a, float b, size_t n) -> void
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                dst[i] = src[i] * a * b;
+            }
+        }
+
+        BRMA_SIMD_NO_CONTRACT
+        inline auto add_scaled(float *dst, float const *src, float a, size_t n) -> void
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                float const product{ src[i] * a };
+                dst[i] += product;
+            }
+        }
+
+        // Finish a vector first-minimum search: pick the smallest lane value,
+        // the lowest index among lanes holding it, then scan the tail.
+        inline auto reduce_lanes(float const *lane_values, int32_t const *lane_indexes, size_t lanes,
+                                 float const *values, size_t tail_first, size_t n) -> size_t
+        {
+            size_t best_lane = 0;
+            for (size_t lane = 1; lane < lanes; ++lane)
+            {
+                if (lane_values[lane] < lane_values[best_lane] ||
+                    (lane_values[lane] == lane_values[best_lane] && lane_indexes[lane] < lane_indexes[best_lane]))
+                {
+                    best_lane = lane;
+                }
+            }
+
+            size_t best = static_cast<size_t>(lane_indexes[best_lane]);
+            for (size_t i = tail_first; i < n; ++i)
+            {
+                if (values[i] < values[best])
+                {
+                    best = i;
+                }
+            }
+
+            return best;
+        }
+
+        // Vector lane indexes are 32-bit, so long scans run first_min over
+        // chunks they can count, offsetting each chunk's first minimum by
+        // where the chunk starts. src is null when nothing is added.
+        template <typename FirstMin>
+        auto chunked_first_min(float *values, float const *src, size_t n, FirstMin first_min) -> size_t
+        {
+            constexpr size_t chunk{ size_t{ 1 } << 30 };
+            size_t best = 0;
+            for (size_t first = 0; first < n; first += chunk)
+            {
+                size_t const found{ first + first_min(values + first, src == nullptr ? nullptr : src + first, std::min(chunk, n - first)) };
+                if (first == 0 || values[found] < values[best])
+                {
+                    best = found;
+                }
+            }
+
+            return best;
+        }
+    }
+
+#if BRMA_SIMD_X86
+    namespace sse4_2
+    {
+        BRMA_SIMD_TARGET("sse4.2")
+        inline auto add(float *dst, float const *src, size_t n) -> void
+        {
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+            }
+
+            scalar::add(dst + i, src + i, n - i);
+        }
+
+        // First minimum of values, optionally adding src into it first. Each
+        // lane keeps the first occurrence of its own minimum; lanes start at
+        // +infinity with index 0, which is only picked when every value is
+        // +infinity and then 0 is the right answer. n must fit the 32-bit
+        // lane indexes; see chunked_first_min.
+        template <bool Add>
+        BRMA_SIMD_TARGET("sse4.2")
+        inline auto first_min(float *values, float const *src, size_t n) -> size_t
+        {
+            __m128 best = _mm_set1_ps(std::numeric_limits<float>::infinity());
+            __m128i best_index = _mm_setzero_si128();
+            __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+            __m128i const step = _mm_set1_epi32(4);
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m128 v = _mm_loadu_ps(values + i);
+                if constexpr (Add)
+                {
+                    v = _mm_add_ps(v, _mm_loadu_ps(src + i));
+                    _mm_storeu_ps(values + i, v);
+                }
+
+                __m128 const lower = _mm_cmplt_ps(v, best);
+                best = _mm_blendv_ps(best, v, lower);
+                best_index = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(best_index), _mm_castsi128_ps(index), lower));
+                index = _mm_add_epi32(index, step);
+            }
+
+            if constexpr (Add)
+            {
+                scalar::add(values + i, src + i, n - i);
+            }
+
+            alignas(16) float lane_values[4];
+            alignas(16) int32_t lane_indexes[4];
+            _mm_store_ps(lane_values, best);
+            _mm_store_si128(reinterpret_cast<__m128i *>(lane_indexes), best_index);
+            return scalar::reduce_lanes(lane_values, lane_indexes, 4, values, i, n);
+        }
+
+        inline auto min_element(float const *values, size_t n) -> size_t
+        {
+            return scalar::chunked_first_min(const_cast<float *>(values), nullptr, n, first_min<false>);
+        }
+
+        inline auto add_min(float *dst, float const *src, size_t n) -> size_t
+        {
+            return scalar::chunked_first_min(dst, src, n, first_min<true>);
+        }
+
+        BRMA_SIMD_TARGET("sse4.2")
+        inline auto scale(float *dst, float const *src, float a, float b, size_t n) -> void
+        {
+            __m128 const va = _mm_set1_ps(a);
+            __m128 const vb = _mm_set1_ps(b);
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(src + i), va), vb));
+            }
+
+            scalar::scale(dst + i, src + i, a, b, n - i);
+        }
+
+        BRMA_SIMD_TARGET("sse4.2") BRMA_SIMD_NO_CONTRACT
+        inline auto add_scaled(float *dst, float const *src, float a, size_t n) -> void
+        {
+            __m128 const va = _mm_set1_ps(a);
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), va)));
+            }
+
+            scalar::add_scaled(dst + i, src + i, a, n - i);
+        }
+    }
+
+    namespace avx2
+    {
+        BRMA_SIMD_TARGET("avx2")
+        inline auto add(float *dst, float const *src, size_t n) -> void
+        {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+            }
+
+            scalar::add(dst + i, src + i, n - i);
+        }
+
+        template <bool Add>
+        BRMA_SIMD_TARGET("avx2")
+        inline auto first_min(float *values, float const *src, size_t n) -> size_t
+        {
+            __m256 best = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+            __m256i best_index = _mm256_setzero_si256();
+            __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            __m256i const step = _mm256_set1_epi32(8);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256 v = _mm256_loadu_ps(values + i);
+                if constexpr (Add)
+                {
+                    v = _mm256_add_ps(v, _mm256_loadu_ps(src + i));
+                    _mm256_storeu_ps(values + i, v);
+                }
+
+                __m256 const lower = _mm256_cmp_ps(v, best, _CMP_LT_OQ);
+                best = _mm256_blendv_ps(best, v, lower);
+                best_index = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(best_index), _mm256_castsi256_ps(index), lower));
+                index = _mm256_add_epi32(index, step);
+            }
+
+            if constexpr (Add)
+            {
+                scalar::add(values + i, src + i, n - i);
+            }
+
+            alignas(32) float lane_values[8];
+            alignas(32) int32_t lane_indexes[8];
+            _mm256_store_ps(lane_values, best);
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lane_indexes), best_index);
+            return scalar::reduce_lanes(lane_values, lane_indexes, 8, values, i, n);
+        }
+
+        inline auto min_element(float const *values, size_t n) -> size_t
+        {
+            return scalar::chunked_first_min(const_cast<float *>(values), nullptr, n, first_min<false>);
+        }
+
+        inline auto add_min(float *dst, float const *src, size_t n) -> size_t
+        {
+            return scalar::chunked_first_min(dst, src, n, first_min<true>);
+        }
+
+        BRMA_SIMD_TARGET("avx2")
+        inline auto scale(float *dst, float const *src, float a, float b, size_t n) -> void
+        {
+            __m256 const va = _mm256_set1_ps(a);
+            __m256 const vb = _mm256_set1_ps(b);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), va), vb));
+            }
+
+            scalar::scale(dst + i, src + i, a, b, n - i);
+        }
+
+        BRMA_SIMD_TARGET("avx2") BRMA_SIMD_NO_CONTRACT
+        inline auto add_scaled(float *dst, float const *src, float a, size_t n) -> void
+        {
+            __m256 const va = _mm256_set1_ps(a);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), va)));
+            }
+
+            scalar::add_scaled(dst + i, src + i, a, n - i);
+        }
+    }
+
+    namespace avx512
+    {
+        BRMA_SIMD_TARGET("avx512f")
+        inline auto add(float *dst, float const *src, size_t n) -> void
+        {
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(dst + i), _mm512_loadu_ps(src + i)));
+            }
+
+            if (i < n)
+            {
+                auto const tail = static_cast<__mmask16>((1U << (n - i)) - 1U);
+                _mm512_mask_storeu_ps(dst + i, tail, _mm512_add_ps(_mm512_maskz_loadu_ps(tail, dst + i), _mm512_maskz_loadu_ps(tail, src + i)));
+            }
+        }
+
+        template <bool Add>
+        BRMA_SIMD_TARGET("avx512f")
+        inline auto first_min(float *values, float const *src, size_t n) -> size_t
+        {
+            __m512 best = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+            __m512i best_index = _mm512_setzero_si512();
+            __m512i index = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+            __m512i const step = _mm512_set1_epi32(16);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                __m512 v = _mm512_loadu_ps(values + i);
+                if constexpr (Add)
+                {
+                    v = _mm512_add_ps(v, _mm512_loadu_ps(src + i));
+                    _mm512_storeu_ps(values + i, v);
+                }
+
+                __mmask16 const lower = _mm512_cmp_ps_mask(v, best, _CMP_LT_OQ);
+                best = _mm512_mask_mov_ps(best, lower, v);
+                best_index = _mm512_mask_mov_epi32(best_index, lower, index);
+                index = _mm512_add_epi32(index, step);
+            }
+
+            if constexpr (Add)
+            {
+                scalar::add(values + i, src + i, n - i);
+            }
+
+            alignas(64) float lane_values[16];
+            alignas(64) int32_t lane_indexes[16];
+            _mm512_store_ps(lane_values, best);
+            _mm512_store_si512(lane_indexes, best_index);
+            return scalar::reduce_lanes(lane_values, lane_indexes, 16, values, i, n);
+        }
+
+        inline auto min_element(float const *values, size_t n) -> size_t
+        {
+            return scalar::chunked_first_min(const_cast<float *>(values), nullptr, n, first_min<false>);
+        }
+
+        inline auto add_min(float *dst, float const *src, size_t n) -> size_t
+        {
+            return scalar::chunked_first_min(dst, src, n, first_min<true>);
+        }
+
+        BRMA_SIMD_TARGET("avx512f")
+        inline auto scale(float *dst, float const *src, float a, float b, size_t n) -> void
+        {
+            __m512 const va = _mm512_set1_ps(a);
+            __m512 const vb = _mm512_set1_ps(b);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_mul_ps(_mm512_loadu_ps(src + i), va), vb));
+            }
+
+            scalar::scale(dst + i, src + i, a, b, n - i);
+        }
+
+        BRMA_SIMD_TARGET("avx512f") BRMA_SIMD_NO_CONTRACT
+        inline auto add_scaled(float *dst, float const *src, float a, size_t n) -> void
+        {
+            __m512 const va = _mm512_set1_ps(a);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(dst + i), _mm512_mul_ps(_mm512_loadu_ps(src + i), va)));
+            }
+
+            if (i < n)
+            {
+                auto const tail = static_cast<__mmask16>((1U << (n - i)) - 1U);
+                __m512 const product = _mm512_mul_ps(_mm512_maskz_loadu_ps(tail, src + i), va);
+                _mm512_mask_storeu_ps(dst + i, tail, _mm512_add_ps(_mm512_maskz_loadu_ps(tail, dst + i), product));
+            }
+        }
+    }
+#endif
+
+    /// @brief Gets the best instruction set both the compiler and the CPU
+    /// support.
+    inline auto detect() -> isa
+    {
+#if BRMA_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return isa::avx512;
+        }
+
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return isa::avx2;
+        }
+
+        if (__builtin_cpu_supports("sse4.2"))
+        {
+            return isa::sse4_2;
+        }
+#elif BRMA_SIMD_X86 && defined(_MSC_VER)
+        int regs[4]{};
+        __cpuid(regs, 1);
+        bool const sse4_2_ok{ (regs[2] & (1 << 20)) != 0 };
+        bool const os_avx{ (regs[2] & (1 << 27)) != 0 && (regs[2] & (1 << 28)) != 0 };
+        unsigned long long const xcr0{ os_avx ? _xgetbv(0) : 0 };
+        __cpuidex(regs, 7, 0);
+        if (os_avx && (xcr0 & 0xE6) == 0xE6 && (regs[1] & (1 << 16)) != 0)
+        {
+            return isa::avx512;
+        }
+
+        if (os_avx && (xcr0 & 0x6) == 0x6 && (regs[1] & (1 << 5)) != 0)
+        {
+            return isa::avx2;
+        }
+
+        if (sse4_2_ok)
+        {
+            return isa::sse4_2;
+        }
+#endif
+        return isa::scalar;
+    }
+
+    /// @brief Gets the kernels for the given instruction set. The caller must
+    /// make sure the CPU supports it.
+    inline auto kernels_for(isa set) -> kernels
+    {
+        switch (set)
+        {
+#if BRMA_SIMD_X86
+        case isa::avx512:
+            return { avx512::add, avx512::min_element, avx512::add_min, avx512::scale, avx512::add_scaled };
+        case isa::avx2:
+            return { avx2::add, avx2::min_element, avx2::add_min, avx2::scale, avx2::add_scaled };
+        case isa::sse4_2:
+            return { sse4_2::add, sse4_2::min_element, sse4_2::add_min, sse4_2::scale, sse4_2::add_scaled };
+#endif
+        default:
+            return { scalar::add, scalar::min_element, scalar::add_min, scalar::scale, scalar::add_scaled };
+        }
+    }
+
+    /// @brief Gets the kernels for the running CPU, detected once.
+    inline auto active() -> kernels const &
+    {
+        static kernels const active_kernels{ kernels_for(detect()) };
+        return active_kernels;
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+// Define BRMA_STATS to 1 before including the library to record where
+// stippling and encoding spend their time. Otherwise the stats stay zero and
+// the recording compiles to nothing.
+#ifndef BRMA_STATS
+#define BRMA_STATS 0
+#endif
+
+namespace brma
+{
+    /// @brief Where a stipple's time went. Zero unless BRMA_STATS is 1.
+    struct stipple_stats
+    {
+        /// @brief Building the energy field, splat and min index.
+        std::chrono::nanoseconds setup{};
+        /// @brief Finding the next sample. In full-frame mode the minimum is
+        /// found while the splat is added, so it counts as update.
+        std::chrono::nanoseconds argmin{};
+        /// @brief Adding splats to the energy and keeping the index current.
+        std::chrono::nanoseconds update{};
+        /// @brief Samples placed.
+        std::size_t iterations{ 0 };
+        /// @brief Buffers allocated or grown, the result's included.
+        std::size_t allocations{ 0 };
+        /// @brief Bytes held by those buffers.
+        std::size_t allocated_bytes{ 0 };
+    };
+
+    /// @brief Where a mask_braille call's time went. Zero unless BRMA_STATS
+    /// is 1.
+    struct braille_stats
+    {
+        /// @brief Sizing the output and setting up the padded views.
+        std::chrono::nanoseconds layout{};
+        /// @brief Building the cells and writing them, the newlines and the
+        /// border as UTF-8. These run fused, line by line.
+        std::chrono::nanoseconds encode{};
+        /// @brief Text lines written, border lines included.
+        std::size_t lines{ 0 };
+        /// @brief Braille cells encoded.
+        std::size_t cells{ 0 };
+        /// @brief UTF-8 bytes emitted.
+        std::size_t bytes{ 0 };
+        /// @brief Heap allocations for the output text.
+        std::size_t allocations{ 0 };
+    };
+
+    namespace detail
+    {
+        inline constexpr bool stats_enabled{ BRMA_STATS != 0 };
+
+#if BRMA_STATS
+        // Adds the time from construction to stop() or destruction to a
+        // phase total.
+        class phase_timer
+        {
+            std::chrono::nanoseconds *total_;
+            std::chrono::steady_clock::time_point start_{ std::chrono::steady_clock::now() };
+        public:
+            explicit phase_timer(std::chrono::nanoseconds &total) : total_{ &total }
+            {
+            }
+
+            phase_timer(phase_timer const &) = delete;
+            phase_timer(phase_timer &&) = delete;
+            auto operator=(phase_timer const &) -> phase_timer & = delete;
+            auto operator=(phase_timer &&) -> phase_timer & = delete;
+
+            ~phase_timer()
+            {
+                stop();
+            }
+
+            auto stop() -> void
+            {
+                if (total_ != nullptr)
+                {
+                    *total_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_);
+                    total_ = nullptr;
+                }
+            }
+        };
+#else
+        class phase_timer
+        {
+        public:
+            constexpr explicit phase_timer(std::chrono::nanoseconds &) noexcept
+            {
+            }
+
+            constexpr auto stop() noexcept -> void
+            {
+            }
+        };
+#endif
+
+        // Add n to a counter when stats are recorded.
+        constexpr auto add_stat(std::size_t &counter, std::size_t n) noexcept -> void
+        {
+            if constexpr (stats_enabled)
+            {
+                counter += n;
+            }
+        }
+    }
+}
@@ -0,0 +1,507 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <bit_mask.h>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <span>
+#include <stippled_image.h>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BRMA_POSIX_MMAP 1
+#else
+#define BRMA_POSIX_MMAP 0
+#endif
+
+namespace brma
+{
+    namespace detail
+    {
+        inline constexpr uint64_t hash_prime1{ 0x9E3779B185EBCA87ULL };
+        inline constexpr uint64_t hash_prime2{ 0xC2B2AE3D27D4EB4FULL };
+        inline constexpr uint64_t hash_prime3{ 0x165667B19E3779F9ULL };
+
+        constexpr auto hash_round(uint64_t acc, uint64_t value) -> uint64_t
+        {
+            return std::rotl(acc + (value * hash_prime2), 31) * hash_prime1;
+        }
+
+        constexpr auto hash_avalanche(uint64_t h) -> uint64_t
+        {
+            h ^= h >> 33;
+            h *= hash_prime2;
+            h ^= h >> 29;
+            h *= hash_prime3;
+            return h ^ (h >> 32);
+        }
+
+        // A 64-bit hash of an image's extents and the bits of its values,
+        // element by element, so every layout of the same pixels hashes the
+        // same. Four independent lanes keep the multiplies in flight. Not
+        // cryptographic: it tells images apart, it does not resist attack.
+        template <float_2d_span Input>
+        auto content_hash(Input const &input_img) -> uint64_t
+        {
+            size_t const rows{ input_img.extent(0) };
+            size_t const cols{ input_img.extent(1) };
+            std::array<uint64_t, 4> lanes{ hash_prime1 + hash_prime2, hash_prime2, 0, 0 - hash_prime1 };
+            auto const bits{ [](float v) { return uint64_t{ std::bit_cast<uint32_t>(v) }; } };
+            for (size_t i = 0; i < rows; ++i)
+            {
+                size_t j = 0;
+                for (; j + 8 <= cols; j += 8)
+                {
+                    for (size_t lane = 0; lane < 4; ++lane)
+                    {
+                        lanes[lane] = hash_round(lanes[lane], bits(input_img[i, j + (2 * lane)]) | (bits(input_img[i, j + (2 * lane) + 1]) << 32));
+                    }
+                }
+
+                for (; j < cols; ++j)
+                {
+                    lanes[0] = hash_round(lanes[0], bits(input_img[i, j]));
+                }
+            }
+
+            uint64_t h{ std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18) };
+            h = hash_round(h, rows);
+            h = hash_round(h, cols);
+            return hash_avalanche(h);
+        }
+
+        // The bytes of a cache file, mapped read-only where the platform
+        // can, read into memory otherwise. Move-only.
+        class mapped_file
+        {
+            void const *data_{ nullptr };
+            size_t size_{ 0 };
+            bool mapped_{ false };
+            std::vector<uint64_t> buffer_;
+        public:
+            mapped_file() = default;
+
+            // Takes over bytes built in memory.
+            explicit mapped_file(std::vector<uint64_t> &&buffer, size_t size)
+                : data_{ buffer.data() }, size_{ size }, buffer_{ std::move(buffer) }
+            {
+            }
+
+            mapped_file(mapped_file const &) = delete;
+            auto operator=(mapped_file const &) -> mapped_file & = delete;
+
+            mapped_file(mapped_file &&other) noexcept
+                : data_{ std::exchange(other.data_, nullptr) }, size_{ std::exchange(other.size_, 0) },
+                  mapped_{ std::exchange(other.mapped_, false) }, buffer_{ std::move(other.buffer_) }
+            {
+            }
+
+            auto operator=(mapped_file &&other) noexcept -> mapped_file &
+            {
+                if (this != &other)
+                {
+                    release();
+                    data_ = std::exchange(other.data_, nullptr);
+                    size_ = std::exchange(other.size_, 0);
+                    mapped_ = std::exchange(other.mapped_, false);
+                    buffer_ = std::move(other.buffer_);
+                }
+
+                return *this;
+            }
+
+            ~mapped_file()
+            {
+                release();
+            }
+
+            // Maps the file at path, or returns nothing if it cannot be read.
+            static auto open(std::filesystem::path const &path) -> std::optional<mapped_file>
+            {
+#if BRMA_POSIX_MMAP
+                int const fd{ ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+                if (fd < 0)
+                {
+                    return std::nullopt;
+                }
+
+                struct stat info{};
+                if (::fstat(fd, &info) != 0 || info.st_size <= 0)
+                {
+                    ::close(fd);
+                    return std::nullopt;
+                }
+
+                auto const size{ static_cast<size_t>(info.st_size) };
+                void *const data{ ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) };
+                ::close(fd);
+                if (data == MAP_FAILED)
+                {
+                    return std::nullopt;
+                }
+
+                mapped_file ret;
+                ret.data_ = data;
+                ret.size_ = size;
+                ret.mapped_ = true;
+                return ret;
+#else
+                std::ifstream file{ path, std::ios::binary | std::ios::ate };
+                if (!file)
+                {
+                    return std::nullopt;
+                }
+
+                auto const size{ static_cast<size_t>(file.tellg()) };
+                std::vector<uint64_t> buffer((size + 7) / 8);
+                file.seekg(0);
+                if (size == 0 || !file.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(size)))
+                {
+                    return std::nullopt;
+                }
+
+                return mapped_file{ std::move(buffer), size };
+#endif
+            }
+
+            [[nodiscard]] auto bytes() const -> std::span<std::byte const>
+            {
+                return { static_cast<std::byte const *>(data_), size_ };
+            }
+        private:
+            auto release() -> void
+            {
+#if BRMA_POSIX_MMAP
+                if (mapped_)
+                {
+                    ::munmap(const_cast<void *>(data_), size_);
+                }
+#endif
+                data_ = nullptr;
+                size_ = 0;
+                mapped_ = false;
+            }
+        };
+    }
+
+    /// @brief What a cached stipple depends on: the image, by content hash
+    /// and size, and the stippling parameters.
+    struct stipple_key
+    {
+        uint64_t content_hash{ 0 };
+        uint64_t rows{ 0 };
+        uint64_t cols{ 0 };
+        float percentage{ 0.33f };
+        float sigma{ 0.9f };
+        float content_bias{ 0.5f };
+        float window_sigmas{ 4.0f };
+        bool negate{ false };
+
+        /// @brief Makes the key for stippling an image with the given
+        /// parameters. Hashing reads every pixel once, which is far cheaper
+        /// than stippling but not free; callers that already know the
+        /// image's identity, such as a file's hash, can fill content_hash
+        /// themselves instead.
+        template <float_2d_span Input>
+        static auto of(
+            Input const &input_img,
+            float percentage = 0.33f,
+            float sigma = 0.9f,
+            float content_bias = 0.5f,
+            bool negate = false,
+            float window_sigmas = 4.0f) -> stipple_key
+        {
+            return { detail::content_hash(input_img), input_img.extent(0), input_img.extent(1), percentage, sigma, content_bias, window_sigmas, negate };
+        }
+
+        [[nodiscard]] auto operator==(stipple_key const &) const -> bool = default;
+
+        /// @brief Gets a hash of the whole key, which names its cache file.
+        [[nodiscard]] auto hash() const -> uint64_t
+        {
+            uint64_t h{ detail::hash_prime3 };
+            for (uint64_t const v : { content_hash, rows, cols, uint64_t{ std::bit_cast<uint32_t>(percentage) }, uint64_t{ std::bit_cast<uint32_t>(sigma) },
+                                      uint64_t{ std::bit_cast<uint32_t>(content_bias) }, uint64_t{ std::bit_cast<uint32_t>(window_sigmas) }, uint64_t{ negate } })
+            {
+                h = detail::hash_round(h, v);
+            }
+
+            return detail::hash_avalanche(h);
+        }
+    };
+
+    /// @brief A stipple read from the cache. Its mask and samples view the
+    /// mapped file directly and stay valid while it lives.
+    class cached_stipple
+    {
+        detail::mapped_file file_;
+        stipple_key key_;
+        uint64_t const *words_{ nullptr };
+        sample_spans samples_;
+
+        friend class stipple_cache;
+
+        cached_stipple(detail::mapped_file &&file, stipple_key const &key, uint64_t const *words, sample_spans samples)
+            : file_{ std::move(file) }, key_{ key }, words_{ words }, samples_{ samples }
+        {
+        }
+    public:
+        [[nodiscard]] auto key() const -> stipple_key const & { return key_; }
+
+        /// @brief Gets the stippled image.
+        [[nodiscard]] auto stippled() const -> bit_mask::view_type
+        {
+            return bit_mask::view_of(words_, static_cast<size_t>(key_.rows), static_cast<size_t>(key_.cols));
+        }
+
+        /// @brief Copies the stippled image into a bit_mask, for the packed
+        /// encoding path of mask_braille.
+        [[nodiscard]] auto mask() const -> bit_mask
+        {
+            bit_mask ret{ static_cast<size_t>(key_.rows), static_cast<size_t>(key_.cols) };
+            for (size_t i = 0; i < ret.rows(); ++i)
+            {
+                std::ranges::copy(std::span{ words_ + (i * ret.words_per_row()), ret.words_per_row() }, ret.row(i).begin());
+            }
+
+            return ret;
+        }
+
+        /// @brief Gets the samples, in placement order.
+        [[nodiscard]] auto samples() const -> sample_spans { return samples_; }
+    };
+
+    /// @brief An opt-in on-disk cache of stipples, one file per image and
+    /// parameter set.
+    ///
+    /// A file holds a versioned header repeating the full key, then the
+    /// bit-packed mask and the samples as parallel arrays. Hits are mapped
+    /// read-only and viewed in place, so their cost is opening the file and
+    /// checking the header. Files with another version, a different key or
+    /// a size that does not match their header are treated as misses and
+    /// replaced. Files are written under a temporary name and renamed into
+    /// place, so concurrent readers see a whole file or none. Bump
+    /// format_version whenever the file layout or the stippler's output
+    /// changes.
+    class stipple_cache
+    {
+        std::filesystem::path directory_;
+
+        struct file_header
+        {
+            std::array<char, 8> magic;
+            uint32_t version;
+            uint32_t header_bytes;
+            uint64_t content_hash;
+            uint64_t rows;
+            uint64_t cols;
+            float percentage;
+            float sigma;
+            float content_bias;
+            float window_sigmas;
+            uint64_t negate;
+            uint64_t samples;
+        };
+
+        static_assert(sizeof(file_header) % sizeof(uint64_t) == 0);
+
+        static constexpr std::array<char, 8> magic{ 'B', 'R', 'M', 'A', 'S', 'T', 'P', 'L' };
+    public:
+        /// @brief The file format. Files of any other version are ignored.
+        static constexpr uint32_t format_version{ 1 };
+
+        /// @brief Uses the given directory, creating it if needed.
+        /// @throws std::filesystem::filesystem_error if it cannot be created.
+        explicit stipple_cache(std::filesystem::path directory) : directory_{ std::move(directory) }
+        {
+            std::filesystem::create_directories(directory_);
+        }
+
+        /// @brief Gets the cached stipple for a key, if there is a valid one.
+        [[nodiscard]] auto find(stipple_key const &key) const -> std::optional<cached_stipple>
+        {
+            std::optional<detail::mapped_file> file{ detail::mapped_file::open(path_of(key)) };
+            if (!file)
+            {
+                return std::nullopt;
+            }
+
+            return parse(std::move(*file), key);
+        }
+
+        /// @brief Gets the cached stipple of an image, stippling and storing
+        /// it on a miss. The parameters are the same as stippled_image's.
+        /// @throws std::system_error if a miss cannot be written.
+        template <float_2d_span Input>
+        auto stipple(
+            Input input_img,
+            float percentage = 0.33f,
+            float sigma = 0.9f,
+            float content_bias = 0.5f,
+            bool negate = false,
+            float window_sigmas = 4.0f) const -> cached_stipple
+        {
+            stipple_key const key{ stipple_key::of(input_img, percentage, sigma, content_bias, negate, window_sigmas) };
+            if (std::optional<cached_stipple> hit{ find(key) })
+            {
+                return std::move(*hit);
+            }
+
+            return store(key, stippled_image{ input_img, percentage, sigma, content_bias, negate, window_sigmas });
+        }
+
+        /// @brief Gets the file a key is stored in.
+        [[nodiscard]] auto path_of(stipple_key const &key) const -> std::filesystem::path
+        {
+            std::array<char, 17> name{};
+            uint64_t const h{ key.hash() };
+            for (size_t k = 0; k < 16; ++k)
+            {
+                name[k] = "0123456789abcdef"[(h >> (60 - (4 * k))) & 0xF];
+            }
+
+            return directory_ / (std::string{ name.data(), 16 } + ".brma");
+        }
+    private:
+        // Store a stipple made with the key's image and parameters, and
+        // return it viewing the bytes that were written. Only stipple()
+        // calls it: the key has no field for the tiled, pyramid or batched
+        // modes, so their stipples must not be stored under it. Throws
+        // std::system_error if the file cannot be written.
+        auto store(stipple_key const &key, stippled_image const &stipple) const -> cached_stipple
+        {
+            bit_mask const &mask{ stipple.mask() };
+            sample_spans const samples{ stipple.samples() };
+            size_t const words{ mask.rows() * mask.words_per_row() };
+            size_t const size{ sizeof(file_header) + (words * sizeof(uint64_t)) + (samples.size() * ((2 * sizeof(uint32_t)) + sizeof(float))) };
+            std::vector<uint64_t> buffer((size + 7) / 8);
+            auto *const bytes{ reinterpret_cast<std::byte *>(buffer.data()) };
+            file_header const header{ magic, format_version, sizeof(file_header), key.content_hash, key.rows, key.cols,
+                                      key.percentage, key.sigma, key.content_bias, key.window_sigmas, key.negate, samples.size() };
+            std::memcpy(bytes, &header, sizeof(header));
+            std::byte *out{ bytes + sizeof(header) };
+            for (size_t i = 0; i < mask.rows(); ++i)
+            {
+                std::span<uint64_t const> const row{ mask.row(i) };
+                std::memcpy(out, row.data(), row.size_bytes());
+                out += row.size_bytes();
+            }
+
+            for (auto const part : { std::as_bytes(samples.rows), std::as_bytes(samples.cols), std::as_bytes(samples.values) })
+            {
+                if (!part.empty())
+                {
+                    std::memcpy(out, part.data(), part.size());
+                    out += part.size();
+                }
+            }
+
+            write_file(path_of(key), std::span{ bytes, size });
+            return *parse(detail::mapped_file{ std::move(buffer), size }, key);
+        }
+
+        // Check the header against the key and the file size, and point the
+        // views into the bytes.
+        static auto parse(detail::mapped_file &&file, stipple_key const &key) -> std::optional<cached_stipple>
+        {
+            std::span<std::byte const> const bytes{ file.bytes() };
+            file_header header{};
+            if (bytes.size() < sizeof(header))
+            {
+                return std::nullopt;
+            }
+
+            std::memcpy(&header, bytes.data(), sizeof(header));
+            stipple_key const stored{ header.content_hash, header.rows, header.cols, header.percentage, header.sigma, header.content_bias, header.window_sigmas, header.negate != 0 };
+            // Sizes are checked against the file before they are multiplied,
+            // so a damaged header cannot overflow them.
+            uint64_t const words_per_row{ (header.cols + 63) / 64 };
+            if (header.magic != magic || header.version != format_version || header.header_bytes != sizeof(header) || stored != key ||
+                (words_per_row != 0 && header.rows > bytes.size() / (sizeof(uint64_t) * words_per_row)) ||
+                header.samples > bytes.size() / ((2 * sizeof(uint32_t)) + sizeof(float)))
+            {
+                return std::nullopt;
+            }
+
+            uint64_t const words{ header.rows * words_per_row };
+            if (bytes.size() != sizeof(header) + (words * sizeof(uint64_t)) + (header.samples * ((2 * sizeof(uint32_t)) + sizeof(float))))
+            {
+                return std::nullopt;
+            }
+
+            // The header is a multiple of 8 bytes and the file starts on a
+            // page, so every array is aligned for its type.
+            std::byte const *const data{ bytes.data() + sizeof(header) };
+            auto const *const mask_words{ reinterpret_cast<uint64_t const *>(data) };
+            size_t const count{ header.samples };
+            auto const *const rows{ reinterpret_cast<uint32_t const *>(data + (words * sizeof(uint64_t))) };
+            auto const *const cols{ rows + count };
+            auto const *const values{ reinterpret_cast<float const *>(cols + count) };
+
+            // A damaged body is a miss too: every sample must be on the
+            // image, and the bits past the last column of each row clear.
+            for (size_t k = 0; k < count; ++k)
+            {
+                if (rows[k] >= header.rows || cols[k] >= header.cols)
+                {
+                    return std::nullopt;
+                }
+            }
+
+            if (uint64_t const used{ header.cols % 64 }; used != 0)
+            {
+                uint64_t const padding{ ~uint64_t{ 0 } << used };
+                for (uint64_t i = 0; i < header.rows; ++i)
+                {
+                    if ((mask_words[((i + 1) * words_per_row) - 1] & padding) != 0)
+                    {
+                        return std::nullopt;
+                    }
+                }
+            }
+
+            return cached_stipple{ std::move(file), key, mask_words, { { rows, count }, { cols, count }, { values, count } } };
+        }
+
+        // Write bytes to a temporary file next to path, then rename it over
+        // path.
+        static auto write_file(std::filesystem::path const &path, std::span<std::byte const> bytes) -> void
+        {
+            std::filesystem::path temporary{ path };
+            temporary += ".tmp" + std::to_string(std::random_device{}());
+            {
+                std::ofstream file{ temporary, std::ios::binary | std::ios::trunc };
+                if (!file.write(reinterpret_cast<char const *>(bytes.data()), static_cast<std::streamsize>(bytes.size())) || !file.flush())
+                {
+                    file.close();
+                    std::error_code ignored;
+                    std::filesystem::remove(temporary, ignored);
+                    throw std::system_error(std::make_error_code(std::errc::io_error), "stipple_cache: cannot write " + temporary.string());
+                }
+            }
+
+            std::error_code error;
+            std::filesystem::rename(temporary, path, error);
+            if (error)
+            {
+                std::error_code ignored;
+                std::filesystem::remove(temporary, ignored);
+                throw std::system_error(error, "stipple_cache: cannot rename " + temporary.string());
+            }
+        }
+    };
+}
@@ -1,12 +1,26 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <bit_mask.h>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <concepts>
+#include <cstdint>
 #include <execution>
+#include <limits>
 #include <mdspan>
+#include <memory_resource>
+#include <mutex>
 #include <numeric>
+#include <ranges>
+#include <simd_kernels.h>
+#include <span>
+#include <stats.h>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 namespace brma
@@ -19,192 +33,1781 @@ namespace brma
         requires M::rank() == 2;
     };
 
+    /// @brief Stipple samples as parallel arrays: sample k is the dot at
+    /// (rows[k], cols[k]), where the image had values[k]. The spans view the
+    /// storage of the stipple they came from.
+    struct sample_spans
+    {
+        std::span<uint32_t const> rows;
+        std::span<uint32_t const> cols;
+        std::span<float const> values;
+
+        [[nodiscard]] auto size() const -> size_t { return values.size(); }
+        [[nodiscard]] auto empty() const -> bool { return values.empty(); }
+
+        /// @brief Gets sample k as (row, col, value).
+        [[nodiscard]] auto operator[](size_t k) const -> std::tuple<size_t, size_t, float>
+        {
+            return { rows[k], cols[k], values[k] };
+        }
+
+        /// @brief Gets the samples from offset on.
+        [[nodiscard]] auto subspan(size_t offset) const -> sample_spans
+        {
+            return { rows.subspan(offset), cols.subspan(offset), values.subspan(offset) };
+        }
+    };
+
     namespace detail
     {
-        // Gaussian integral approximation using erf
-        inline auto gauss_small_sigma(std::vector<float> const& xs, float sigma) -> std::vector<float>
+        // Gaussian integral approximation using erf: the mass of a unit
+        // pixel at distance x
+        inline auto gauss_small_sigma(float x, float sigma) -> float
         {
-            std::vector<float> result;
-            result.reserve(xs.size());
             static float const sqrt_half = std::sqrt(0.5f);
+            float const p1 = std::erf((x - 0.5f) / sigma * sqrt_half);
+            float const p2 = std::erf((x + 0.5f) / sigma * sqrt_half);
+            return (p2 - p1) / 2.0f;
+        }
+
+        // The Gaussian factor of each index of a length n ring, by its
+        // distance from index 0: g(0), g(1), g(2), ..., g(2), g(1)
+        inline auto wrapped_gauss(size_t n, float sigma, std::vector<float> &result) -> void
+        {
+            result.resize(n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                result[i] = gauss_small_sigma(static_cast<float>(std::min(i, n - i)), sigma);
+            }
+        }
 
-            for (float const val : xs)
+        // Radius, in pixels, of the toroidal window a windowed energy update
+        // touches. Returns 0 (update the full field) when window_sigmas <= 0
+        // or when the window would cover a whole rows x cols dimension anyway.
+        inline auto window_radius(size_t rows, size_t cols, float sigma, float window_sigmas) -> size_t
+        {
+            if (window_sigmas <= 0.0f)
             {
-                float const p1 = std::erf((val - 0.5f) / sigma * sqrt_half);
-                float const p2 = std::erf((val + 0.5f) / sigma * sqrt_half);
-                result.push_back((p2 - p1) / 2.0f);
+                return 0;
             }
 
-            return result;
+            auto const radius = static_cast<size_t>(std::ceil(window_sigmas * sigma));
+            return 2 * radius + 1 < std::min(rows, cols) ? radius : 0;
         }
 
-        // Outer product
-        inline auto outer_product(std::vector<float> const& v, std::vector<float> &backing) -> std::mdspan<float, std::dextents<size_t, 2>>
+        // The LUT within radius of its [0, 0] center as a contiguous
+        // row-major (2 * radius + 1)^2 window centered on [radius, radius].
+        // Holds the same values as the wrapped LUT, infinite center included.
+        inline auto splat_window(float sigma, size_t radius, std::vector<float> &window) -> void
         {
-            size_t n = v.size();
-            backing.resize(n * n);
-            std::mdspan result(backing.data(), n, n);
-            for (size_t i = 0; i < n; ++i)
-                for (size_t j = 0; j < n; ++j)
-                    result[i, j] = v[i] * v[j];
-            return result;
+            // The window is the outer product of the factors. They are put in
+            // row 0 and expanded bottom-up, so nothing but the window is
+            // allocated and row 0 is overwritten last.
+            size_t const width = (2 * radius) + 1;
+            window.resize(width * width);
+            for (size_t i = 0; i < width; ++i)
+            {
+                window[i] = gauss_small_sigma(static_cast<float>(i < radius ? radius - i : i - radius), sigma);
+            }
+
+            for (size_t i = width; i-- > 0;)
+            {
+                float const row_factor = window[i];
+                for (size_t j = 0; j < width; ++j)
+                {
+                    window[(i * width) + j] = row_factor * window[j];
+                }
+            }
+
+            window[(radius * width) + radius] = std::numeric_limits<float>::infinity();
+        }
+
+        inline auto splat_window(float sigma, size_t radius) -> std::vector<float>
+        {
+            std::vector<float> window;
+            splat_window(sigma, radius, window);
+            return window;
+        }
+
+        // Add a splat_window to the contiguous rows x cols energy, centered on
+        // (cx, cy) and wrapping around the edges.
+        inline auto add_window(float *energy, size_t rows, size_t cols, std::vector<float> const &window, size_t cx, size_t cy, size_t radius) -> void
+        {
+            size_t const width = (2 * radius) + 1;
+            size_t const first_col = (cy + cols - radius) % cols;
+            size_t const head = std::min(width, cols - first_col);
+
+            // Window rows are too short for a dispatched vector add to pay
+            // off; the inlined scalar loop is left to the compiler.
+            size_t row = (cx + rows - radius) % rows;
+            for (float const *src = window.data(); src != window.data() + window.size(); src += width)
+            {
+                simd::scalar::add(energy + (row * cols) + first_col, src, head);
+                simd::scalar::add(energy + (row * cols), src + head, width - head);
+                row = row + 1 == rows ? 0 : row + 1;
+            }
+        }
+
+        // add_window for an energy field and window stored in an
+        // energy_format, through the format's row kernel.
+        template <typename Energy>
+        auto add_window(typename Energy::storage *energy, size_t rows, size_t cols, std::vector<typename Energy::storage> const &window,
+                        size_t cx, size_t cy, size_t radius) -> void
+        {
+            size_t const width = (2 * radius) + 1;
+            size_t const first_col = (cy + cols - radius) % cols;
+            size_t const head = std::min(width, cols - first_col);
+
+            size_t row = (cx + rows - radius) % rows;
+            for (auto const *src = window.data(); src != window.data() + window.size(); src += width)
+            {
+                Energy::add(energy + (row * cols) + first_col, src, head);
+                Energy::add(energy + (row * cols), src + head, width - head);
+                row = row + 1 == rows ? 0 : row + 1;
+            }
         }
 
-        // Energy shift by wrapping LUT
-        template <float_2d_span T>
-        auto roll_2d(T const &mat, size_t dx, size_t dy, std::vector<float> &backing) -> std::mdspan<float, std::dextents<size_t, 2>>
+        /// @brief Keeps the first minimum of a rows x cols row-major region of
+        /// values findable without scanning the whole region.
+        ///
+        /// Level 0 holds the minimum of each run of block_size columns of a
+        /// row; every level above holds the minimum of block_size entries of
+        /// the level below. After the region changes only the touched blocks
+        /// and their ancestors are recomputed. Ties resolve to the lowest
+        /// row-major position, matching std::ranges::min_element. Values
+        /// narrower than 32 bits are indexed by 32-bit positions, so their
+        /// entries take 8 bytes instead of 16; such regions must have fewer
+        /// than 2^32 values.
+        template <typename T>
+        class basic_min_index
         {
-            // assert layout_right
-            static_assert(std::is_same_v<typename T::layout_type, std::layout_right>,
-                "mat must be row-major (std::layout_right)");
-            // assert contiguous
-            assert((&mat[0, 1] == &mat[0, 0] + 1));
-            assert((&mat[1, 0] == &mat[0, 0] + mat.extent(1)));
+        public:
+            static constexpr size_t block_size{ 16 };
+            using position = std::conditional_t<(sizeof(T) < sizeof(uint32_t)), uint32_t, size_t>;
 
-            size_t const n = mat.extent(0);
+            basic_min_index() = default;
+
+            basic_min_index(T const *data, size_t rows, size_t cols, size_t stride)
+            {
+                reset(data, rows, cols, stride);
+            }
 
-            // assert square
-            assert(n == mat.extent(1));
+            /// @brief Points the index at another region, keeping the level
+            /// storage it already has.
+            auto reset(T const *data, size_t rows, size_t cols, size_t stride) -> void
+            {
+                assert(rows * cols <= std::numeric_limits<position>::max());
+                data_ = data;
+                rows_ = rows;
+                cols_ = cols;
+                stride_ = stride;
+                blocks_per_row_ = (cols + block_size - 1) / block_size;
+                size_t entries{ rows_ * blocks_per_row_ };
+                size_t level{ 0 };
+                do
+                {
+                    if (levels_.size() == level)
+                    {
+                        levels_.emplace_back();
+                    }
 
-            backing.resize(n * n);
-            std::mdspan const result(backing.data(), n, n);
-            dx %= n;
-            dy %= n;
+                    levels_[level++].resize(entries);
+                    entries = (entries + block_size - 1) / block_size;
+                } while (levels_[level - 1].size() > block_size);
 
-            // make a vector of row indices [0,1,2,...,n-1]
-            std::vector<size_t> rows(n);
-            std::ranges::iota(rows, 0);
+                levels_.resize(level);
+                rebuild();
+            }
+
+            /// @brief Recomputes every level from the region.
+            auto rebuild() -> void
+            {
+                for (size_t row = 0; row < rows_; ++row)
+                {
+                    for (size_t block = 0; block < blocks_per_row_; ++block)
+                    {
+                        update_block(row, block);
+                    }
+                }
+
+                for (size_t level = 1; level < levels_.size(); ++level)
+                {
+                    for (size_t i = 0; i < levels_[level].size(); ++i)
+                    {
+                        update_entry(level, i);
+                    }
+                }
+            }
+
+            /// @brief Recomputes the blocks covering columns [first_col,
+            /// last_col) of the given row and their ancestors.
+            auto update(size_t row, size_t first_col, size_t last_col) -> void
+            {
+                assert(row < rows_ && first_col < last_col && last_col <= cols_);
+                size_t first{ row * blocks_per_row_ + first_col / block_size };
+                size_t last{ row * blocks_per_row_ + (last_col - 1) / block_size };
+                for (size_t block = first; block <= last; ++block)
+                {
+                    update_block(row, block - (row * blocks_per_row_));
+                }
+
+                for (size_t level = 1; level < levels_.size(); ++level)
+                {
+                    first /= block_size;
+                    last /= block_size;
+                    for (size_t i = first; i <= last; ++i)
+                    {
+                        update_entry(level, i);
+                    }
+                }
+            }
+
+            [[nodiscard]] auto rows() const -> size_t { return rows_; }
+            [[nodiscard]] auto cols() const -> size_t { return cols_; }
+
+            /// @brief Gets the (row, col) of the first minimum in the region.
+            [[nodiscard]] auto argmin() const -> std::pair<size_t, size_t>
+            {
+                auto const &top{ levels_.back() };
+                size_t const pos{ std::ranges::min_element(top, less)->pos };
+                return { pos / cols_, pos % cols_ };
+            }
+
+            /// @brief Gets the bytes held by the levels.
+            [[nodiscard]] auto allocated_bytes() const -> size_t
+            {
+                size_t ret{ 0 };
+                for (auto const &level : levels_)
+                {
+                    ret += level.capacity() * sizeof(entry);
+                }
+
+                return ret;
+            }
+
+        private:
+            struct entry
+            {
+                T value;
+                position pos;
+            };
+
+            static auto less(entry const &a, entry const &b) -> bool
+            {
+                return a.value < b.value || (a.value == b.value && a.pos < b.pos);
+            }
+
+            auto update_block(size_t row, size_t block) -> void
+            {
+                size_t const first_col{ block * block_size };
+                size_t const last_col{ std::min(first_col + block_size, cols_) };
+                // Blocks are too short for a dispatched vector scan to pay off.
+                T const *row_data{ data_ + (row * stride_) };
+                T const *min{ std::min_element(row_data + first_col, row_data + last_col) };
+                levels_[0][(row * blocks_per_row_) + block] = {
+                    *min, static_cast<position>((row * cols_) + static_cast<size_t>(min - row_data)) };
+            }
+
+            auto update_entry(size_t level, size_t i) -> void
+            {
+                auto const &children{ levels_[level - 1] };
+                auto const first{ children.begin() + static_cast<ptrdiff_t>(i * block_size) };
+                auto const last{ children.begin() + static_cast<ptrdiff_t>(std::min((i + 1) * block_size, children.size())) };
+                levels_[level][i] = *std::min_element(first, last, less);
+            }
+
+            T const *data_{ nullptr };
+            size_t rows_{ 0 };
+            size_t cols_{ 0 };
+            size_t stride_{ 0 };
+            size_t blocks_per_row_{ 0 };
+            std::vector<std::vector<entry>> levels_;
+        };
+
+        using min_index = basic_min_index<float>;
+
+        // The output of stippling: the dot mask and the samples, as parallel
+        // arrays, in the order they were placed.
+        struct stipple_data
+        {
+            bit_mask mask;
+            std::pmr::vector<uint32_t> rows;
+            std::pmr::vector<uint32_t> cols;
+            std::pmr::vector<float> values;
+            stipple_stats stats;
+
+            [[nodiscard]] auto size() const -> size_t { return values.size(); }
+
+            auto reserve(size_t count) -> void
+            {
+                rows.reserve(count);
+                cols.reserve(count);
+                values.reserve(count);
+            }
+
+            auto resize(size_t count) -> void
+            {
+                rows.resize(count);
+                cols.resize(count);
+                values.resize(count);
+            }
+
+            auto push_back(size_t row, size_t col, float value) -> void
+            {
+                rows.push_back(static_cast<uint32_t>(row));
+                cols.push_back(static_cast<uint32_t>(col));
+                values.push_back(value);
+            }
+
+            [[nodiscard]] auto spans() const -> sample_spans { return { rows, cols, values }; }
+        };
+
+        // Tell an index over the part of a rows x cols field starting at
+        // (row0, col0) about a toroidally wrapped (2 * radius + 1)^2 window
+        // centered on (cx, cy). Only the part inside the index is updated.
+        template <typename T>
+        auto update_window(basic_min_index<T> &index, size_t rows, size_t cols, size_t cx, size_t cy, size_t radius,
+                           size_t row0 = 0, size_t col0 = 0) -> void
+        {
+            size_t const first_col = (cy + cols - radius) % cols;
+            size_t const last_col = first_col + (2 * radius) + 1;
+            auto const update_cols = [&index, col0](size_t local_row, size_t first, size_t last)
+            {
+                size_t const lo{ std::max(first, col0) };
+                size_t const hi{ std::min(last, col0 + index.cols()) };
+                if (lo < hi)
+                {
+                    index.update(local_row, lo - col0, hi - col0);
+                }
+            };
+
+            size_t row = (cx + rows - radius) % rows;
+            for (size_t di = 0; di <= 2 * radius; ++di)
+            {
+                if (row >= row0 && row < row0 + index.rows())
+                {
+                    if (last_col <= cols)
+                    {
+                        update_cols(row - row0, first_col, last_col);
+                    }
+                    else
+                    {
+                        update_cols(row - row0, first_col, cols);
+                        update_cols(row - row0, 0, last_col - cols);
+                    }
+                }
+
+                row = row + 1 == rows ? 0 : row + 1;
+            }
+        }
+
+        // An empty rows x cols stipple allocated from resource.
+        inline auto init_data(size_t rows, size_t cols, bool negate,
+                              std::pmr::memory_resource *resource = std::pmr::get_default_resource()) -> stipple_data
+        {
+            assert(rows <= std::numeric_limits<uint32_t>::max() && cols <= std::numeric_limits<uint32_t>::max());
+            return stipple_data{ bit_mask{ rows, cols, negate, resource }, std::pmr::vector<uint32_t>{ resource },
+                                 std::pmr::vector<uint32_t>{ resource }, std::pmr::vector<float>{ resource }, {} };
+        }
+
+        // Count the buffers that grew between two snapshots of their sizes
+        // in bytes.
+        template <size_t N>
+        auto count_growth(std::array<size_t, N> const &before, std::array<size_t, N> const &after, stipple_stats &stats) -> void
+        {
+            for (size_t k = 0; k < N; ++k)
+            {
+                if (after[k] > before[k])
+                {
+                    ++stats.allocations;
+                    stats.allocated_bytes += after[k];
+                }
+            }
+        }
+
+        // The starting energy: the image weighted by content_bias.
+        template <float_2d_span Input>
+        auto init_energy(Input const &input_img, float content_bias, bool negate, std::vector<float> &energy_currents_backing) -> void
+        {
+            size_t const rows{ input_img.extent(0) };
+            size_t const cols{ input_img.extent(1) };
+            energy_currents_backing.resize(rows * cols);
+            std::mdspan energy_currents(energy_currents_backing.data(), rows, cols);
+            float sign = negate ? -1.0f : 1.0f;
+            auto const &kernels = simd::active();
+            for (size_t i = 0; i < rows; ++i)
+            {
+                if constexpr (std::is_same_v<typename Input::layout_type, std::layout_right> &&
+                              std::is_same_v<typename Input::accessor_type, std::default_accessor<float>>)
+                {
+                    kernels.scale(&energy_currents[i, 0], &input_img[i, 0], content_bias, sign, cols);
+                }
+                else
+                {
+                    for (size_t j = 0; j < cols; ++j)
+                        energy_currents[i, j] = input_img[i, j] * content_bias * sign;
+                }
+            }
+        }
+
+        template <float_2d_span Input>
+        auto init_energy(Input const &input_img, float content_bias, bool negate) -> std::vector<float>
+        {
+            std::vector<float> energy_currents_backing;
+            init_energy(input_img, content_bias, negate, energy_currents_backing);
+            return energy_currents_backing;
+        }
 
-            // Parallel for_each over rows
+        // Mean of the image. Rows are summed in parallel, then the row sums
+        // in order, in double, so the result does not depend on how the rows
+        // were scheduled.
+        template <float_2d_span Input>
+        auto mean_value(Input const &input_img) -> float
+        {
+            std::vector<double> row_sums(input_img.extent(0));
+            std::vector<size_t> rows(input_img.extent(0));
+            std::ranges::iota(rows, 0);
             std::for_each(
-                std::execution::par,
-                rows.begin(), rows.end(),
-                [dx, dy, n, mat_data = &mat[0,0], result_data = backing.data()](size_t dst_row)
-                {
-                    // find the source row (wrapped)
-                    size_t const src_row = (dst_row + n - dx) % n;
-                    float const* src_row_data{ mat_data + (src_row * n) };
-
-                    // now shift columns: copy tail then head
-                    size_t const cut = n - dy;
-                    // tail -> head of result row
-                    std::memcpy(
-                        result_data + (dst_row * n),
-                        src_row_data + cut,
-                        dy * sizeof(float)
-                    );
-                    // head -> remainder of result row
-                    std::memcpy(
-                        result_data + (dst_row * n) + dy,
-                        src_row_data,
-                        cut * sizeof(float)
-                    );
-                }
-            );
-
-            return result;
+                std::execution::par, rows.begin(), rows.end(),
+                [&input_img, &row_sums, cols = input_img.extent(1)](size_t row)
+                {
+                    double sum{ 0.0 };
+                    for (size_t col = 0; col < cols; ++col)
+                    {
+                        sum += static_cast<double>(input_img[row, col]);
+                    }
+
+                    row_sums[row] = sum;
+                });
+
+            return static_cast<float>(std::accumulate(row_sums.begin(), row_sums.end(), 0.0) / static_cast<double>(input_img.extent(0) * input_img.extent(1)));
         }
     }
 
 
-    class stippled_image
+    template <float_2d_span Input>
+    class stippler;
+
+    /// @brief Scratch buffers a stippler can reuse from one image to the
+    /// next: the energy field, its min index and the splat or its factors. Buffers only
+    /// grow, so once a workspace has stippled the largest image of a batch
+    /// later images allocate nothing but their results.
+    class stipple_workspace
+    {
+        template <float_2d_span Input>
+        friend class stippler;
+
+        std::vector<float> energy_;
+        std::vector<float> row_gvals_;
+        std::vector<float> col_gvals_;
+        std::vector<float> rolled_cols_;
+        std::vector<float> row_update_;
+        std::vector<float> window_;
+        detail::min_index index_;
+
+        [[nodiscard]] auto buffer_bytes() const -> std::array<size_t, 7>
+        {
+            return { energy_.capacity() * sizeof(float), row_gvals_.capacity() * sizeof(float), col_gvals_.capacity() * sizeof(float),
+                     rolled_cols_.capacity() * sizeof(float), row_update_.capacity() * sizeof(float), window_.capacity() * sizeof(float),
+                     index_.allocated_bytes() };
+        }
+    public:
+        /// @brief Reserves the energy field for images of up to the given
+        /// number of pixels.
+        auto reserve(size_t pixels) -> void
+        {
+            energy_.reserve(pixels);
+        }
+    };
+
+    namespace detail
+    {
+        // Workspaces shared by the workers of a batch. A worker takes one
+        // for each image and puts it back after, so there are never more
+        // workspaces than workers running at once.
+        class workspace_pool
+        {
+            std::mutex mutex_;
+            std::vector<stipple_workspace> free_;
+            size_t pixels_;
+        public:
+            explicit workspace_pool(size_t pixels) : pixels_{ pixels }
+            {
+            }
+
+            auto acquire() -> stipple_workspace
+            {
+                std::lock_guard const lock{ mutex_ };
+                if (free_.empty())
+                {
+                    stipple_workspace ret;
+                    ret.reserve(pixels_);
+                    return ret;
+                }
+
+                stipple_workspace ret{ std::move(free_.back()) };
+                free_.pop_back();
+                return ret;
+            }
+
+            auto release(stipple_workspace &&workspace) -> void
+            {
+                std::lock_guard const lock{ mutex_ };
+                free_.push_back(std::move(workspace));
+            }
+        };
+    }
+
+    /// @brief Greedily places stipple samples a batch at a time, so callers
+    /// can show intermediate results and stop early.
+    ///
+    /// Samples come out in the same order stippled_image places them, so
+    /// stopping after n samples gives the n-sample stipple.
+    /// @tparam Input The 2D mdspan of float being stippled. It must outlive
+    ///     the stippler.
+    template <float_2d_span Input>
+    class stippler
     {
         // based on code from https://bartwronski.com/2022/08/31/progressive-image-stippling-and-greedy-blue-noise-importance-sampling/
         // thank you Bart Wronski
-        struct data
-        {
-            size_t size;
-            std::vector<uint8_t> backing;
-            std::vector<std::tuple<size_t, size_t, float>> samples;
-        } data_;
+        Input input_img_;
+        detail::stipple_data data_;
+        bool dot_value_;
+        size_t sample_count_;
+        size_t radius_;
+        stipple_workspace ws_;
+        size_t pos_{ 0 };
     public:
-        explicit stippled_image(
-            float_2d_span auto input_img, 
+        /// @brief Gets ready to stipple the given image. No samples are placed
+        /// until step() or step_for() is called.
+        /// @param window_sigmas Each sample only updates the energy within
+        ///     window_sigmas * sigma pixels of it. The Gaussian mass dropped
+        ///     per sample is below 2 * erfc(window_sigmas / sqrt(2)), about
+        ///     1.3e-4 for the default. Use 0 to update the full field every
+        ///     iteration, which is O(size^2) per sample instead of O(sigma^2).
+        explicit stippler(
+            Input input_img,
             float percentage = 0.33f,
             float sigma = 0.9f,
             float content_bias = 0.5f,
-            bool negate = false) : data_{init_backing(input_img, percentage, sigma, content_bias, negate)}
+            bool negate = false,
+            float window_sigmas = 4.0f)
+            : stippler(stipple_workspace{}, input_img, percentage, sigma, content_bias, negate, window_sigmas)
         {
         }
 
-        /// @brief Gets the stippled image.
-        /// @return The stippled image.
-        [[nodiscard]] auto stippled() const -> std::mdspan<bool const, std::dextents<size_t, 2>> { return std::mdspan{ reinterpret_cast<bool const*>(data_.backing.data()), data_.size, data_.size }; }
+        /// @brief Gets ready to stipple the given image in the buffers of a
+        /// workspace handed back by an earlier finish().
+        /// @param resource Where the result's mask and samples are allocated.
+        stippler(
+            stipple_workspace &&workspace,
+            Input input_img,
+            float percentage = 0.33f,
+            float sigma = 0.9f,
+            float content_bias = 0.5f,
+            bool negate = false,
+            float window_sigmas = 4.0f,
+            std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+            : input_img_{ input_img },
+              data_{ detail::init_data(input_img.extent(0), input_img.extent(1), negate, resource) },
+              dot_value_{ !negate },
+              sample_count_{ static_cast<size_t>(static_cast<float>(data_.mask.rows() * data_.mask.cols()) * percentage) },
+              radius_{ detail::window_radius(data_.mask.rows(), data_.mask.cols(), sigma, window_sigmas) },
+              ws_{ std::move(workspace) }
+        {
+            detail::phase_timer const setup_timer{ data_.stats.setup };
+            auto const before{ ws_.buffer_bytes() };
+            detail::init_energy(input_img, content_bias, negate, ws_.energy_);
+            if (radius_ != 0)
+            {
+                detail::splat_window(sigma, radius_, ws_.window_);
+                ws_.index_.reset(ws_.energy_.data(), data_.mask.rows(), data_.mask.cols(), data_.mask.cols());
+            }
+            else
+            {
+                // The full-frame splat is the outer product of these, with an
+                // infinite center; it is never built.
+                detail::wrapped_gauss(data_.mask.rows(), sigma, ws_.row_gvals_);
+                detail::wrapped_gauss(data_.mask.cols(), sigma, ws_.col_gvals_);
+                ws_.rolled_cols_.resize(data_.mask.cols());
+                ws_.row_update_.resize(data_.mask.cols());
+                pos_ = detail::simd::active().min_element(ws_.energy_.data(), ws_.energy_.size());
+            }
 
-        /// @brief Gets the samples used to create the stippled image.
-        /// @return The samples used to create the stippled image.
-        [[nodiscard]] auto samples() const -> std::vector<std::tuple<size_t, size_t, float>> { return data_.samples; }
-    private:
-        static auto init_backing(
-            float_2d_span auto input_img, 
-            float percentage, 
-            float sigma,
-            float content_bias, 
-            bool negate) -> data
-        {
-            assert(input_img.extents().rank() == 2 && input_img.extent(0) == input_img.extent(1));
-            uint8_t const dot_value = negate ? 0u : 1u;
-            uint8_t const background_value = negate ? 1u : 0u;
-            data ret;
-            ret.size = input_img.extent(0);
-            ret.backing.resize(input_img.extent(0) * input_img.extent(0));
-            ret.backing.assign(ret.backing.size(), background_value);
-            assert(input_img.extent(1) == ret.size && "input_img must be square");
-
-            // ReSharper disable once CppInconsistentNaming
-            std::vector<float> half1s(ret.size / 2);
-            // ReSharper disable once CppInconsistentNaming
-            std::vector<float> half2s(ret.size / 2);
-            std::generate(half1s.begin(), half1s.end(), [i = 0.0f]() mutable { return i++; });
-            std::generate(half2s.begin(), half2s.end(), [n = ret.size / 2]() mutable
-                {
-                    return static_cast<float>(n--);
-                });
+            // Handed out spans stay valid while samples are added.
+            data_.reserve(sample_count_);
+            if constexpr (detail::stats_enabled)
+            {
+                detail::count_growth(before, ws_.buffer_bytes(), data_.stats);
+                detail::count_growth(std::array<size_t, 4>{}, std::array<size_t, 4>{
+                    data_.mask.rows() * data_.mask.words_per_row() * sizeof(uint64_t), data_.rows.capacity() * sizeof(uint32_t),
+                    data_.cols.capacity() * sizeof(uint32_t), data_.values.capacity() * sizeof(float) }, data_.stats);
+            }
+        }
 
-            std::vector<float> wrapped_pattern_xs;
-            wrapped_pattern_xs.reserve(ret.size);
-            wrapped_pattern_xs.insert(wrapped_pattern_xs.end(), half1s.begin(), half1s.end());
-            wrapped_pattern_xs.insert(wrapped_pattern_xs.end(), half2s.begin(), half2s.end());
+        stippler(stippler const &) = delete;
+        stippler(stippler &&) noexcept = default;
+        auto operator=(stippler const &) -> stippler & = delete;
+        auto operator=(stippler &&) noexcept -> stippler & = default;
+        ~stippler() = default;
 
-            std::vector<float> const gvals{ detail::gauss_small_sigma(wrapped_pattern_xs, sigma) };
-            std::vector<float> luts_backing;
-            std::mdspan<float, std::dextents<size_t, 2>> luts{ detail::outer_product(gvals, luts_backing) };
-            luts[0, 0] = std::numeric_limits<float>::infinity();
+        /// @brief Places up to count more samples.
+        /// @return The samples placed by this call, valid until the stippler
+        ///     is destroyed or finished.
+        auto step(size_t count) -> sample_spans
+        {
+            size_t const first{ data_.size() };
+            size_t const last{ std::min(sample_count_, first + count) };
+            for (size_t iter = first; iter < last; ++iter)
+            {
+                detail::phase_timer argmin_timer{ data_.stats.argmin };
+                auto const [min_x, min_y] = radius_ != 0 ? ws_.index_.argmin() : std::pair{ pos_ / data_.mask.cols(), pos_ % data_.mask.cols() };
+                argmin_timer.stop();
+                detail::phase_timer const update_timer{ data_.stats.update };
 
-            // Construct energy_current
-            std::vector<float> energy_currents_backing;
-            energy_currents_backing.resize(ret.size * ret.size);
-            std::mdspan energy_currents(energy_currents_backing.data(), ret.size, ret.size);
-            float sign = negate ? -1.0f : 1.0f;
-            for (size_t i = 0; i < ret.size; ++i)
-                for (size_t j = 0; j < ret.size; ++j)
-                    energy_currents[i, j] = input_img[i, j] * content_bias * sign;
+                // Update energy with rolled LUT, either just around the
+                // sample or over the whole field. The windowed update keeps
+                // the min index current, the full-frame update finds the next
+                // minimum while it adds.
+                if (radius_ != 0)
+                {
+                    detail::add_window(ws_.energy_.data(), data_.mask.rows(), data_.mask.cols(), ws_.window_, min_x, min_y, radius_);
+                    detail::update_window(ws_.index_, data_.mask.rows(), data_.mask.cols(), min_x, min_y, radius_);
+                }
+                else
+                {
+                    pos_ = add_separable(min_x, min_y);
+                }
 
-            std::mdspan final_stipple(ret.backing.data(), ret.size, ret.size);
+                data_.push_back(min_x, min_y, input_img_[min_x, min_y]);
 
-            const size_t sample_count {static_cast<size_t>(static_cast<float>(ret.size * ret.size) * percentage)};
+                data_.mask.set(min_x, min_y, dot_value_);
+            }
 
-            // ReSharper disable once CppTooWideScope
-            std::vector<float> rolled_backing;
-            for (size_t iter = 0; iter < sample_count; ++iter)
+            detail::add_stat(data_.stats.iterations, last - first);
+            return data_.spans().subspan(first);
+        }
+
+        /// @brief Places samples in batches until the time budget is spent or
+        /// every sample is placed. The budget is checked between batches.
+        /// @return The samples placed by this call, valid until the stippler
+        ///     is destroyed or finished.
+        template <typename Rep, typename Period>
+        auto step_for(std::chrono::duration<Rep, Period> budget, size_t batch = 64) -> sample_spans
+        {
+            auto const deadline{ std::chrono::steady_clock::now() + budget };
+            size_t const first{ data_.size() };
+            do
+            {
+                (void)step(batch);
+            } while (!done() && std::chrono::steady_clock::now() < deadline);
+
+            return data_.spans().subspan(first);
+        }
+
+        /// @brief Whether every sample has been placed.
+        [[nodiscard]] auto done() const -> bool { return data_.size() == sample_count_; }
+
+        /// @brief Gets the number of samples the finished stipple will have.
+        [[nodiscard]] auto sample_count() const -> size_t { return sample_count_; }
+
+        /// @brief Gets the stipple made by the samples placed so far.
+        [[nodiscard]] auto stippled() const -> bit_mask::view_type { return data_.mask.view(); }
+
+        /// @brief Gets the bit-packed stippled image.
+        [[nodiscard]] auto mask() const -> bit_mask const & { return data_.mask; }
+
+        /// @brief Gets the samples placed so far, in placement order.
+        [[nodiscard]] auto samples() const -> sample_spans { return data_.spans(); }
+
+        /// @brief Gets where the time went so far. Zero unless BRMA_STATS is 1.
+        [[nodiscard]] auto stats() const -> stipple_stats const & { return data_.stats; }
+
+        /// @brief Places any remaining samples and hands over the result.
+        [[nodiscard]] auto finish() && -> detail::stipple_data
+        {
+            (void)step(sample_count_);
+            return std::move(data_);
+        }
+
+        /// @brief Places any remaining samples and hands over the result,
+        /// handing the scratch buffers back for the next stippler.
+        [[nodiscard]] auto finish(stipple_workspace &workspace) && -> detail::stipple_data
+        {
+            (void)step(sample_count_);
+            workspace = std::move(ws_);
+            return std::move(data_);
+        }
+    private:
+        // Add the full-frame splat centered on (x, y) a row at a time and
+        // return the position of the first minimum of the new energy. Row i
+        // of the splat is row_gvals[i - x] times the column factors rolled
+        // by y, the same products the outer product LUT held.
+        auto add_separable(size_t x, size_t y) -> size_t
+        {
+            size_t const rows{ data_.mask.rows() };
+            size_t const cols{ data_.mask.cols() };
+            std::ranges::rotate_copy(ws_.col_gvals_, ws_.col_gvals_.end() - static_cast<ptrdiff_t>(y), ws_.rolled_cols_.begin());
+
+            auto const &kernels{ detail::simd::active() };
+            size_t ret{ 0 };
+            float min{ std::numeric_limits<float>::infinity() };
+            for (size_t i = 0; i < rows; ++i)
             {
-                // Find minimum position. This uses the knowledge that
-                // energy_currents and rolled have a backing array that is
-                // contiguous and std::layout_right.
-                ptrdiff_t pos{ std::distance(energy_currents_backing.begin(), std::ranges::min_element(energy_currents_backing)) };
-                size_t min_x = static_cast<size_t>(pos / energy_currents.extent(0));
-                size_t min_y = static_cast<size_t>(pos % energy_currents.extent(0));
+                float *energy_row{ ws_.energy_.data() + (i * cols) };
+                kernels.scale(ws_.row_update_.data(), ws_.rolled_cols_.data(), ws_.row_gvals_[(i + rows - x) % rows], 1.0f, cols);
+                if (i == x)
+                {
+                    ws_.row_update_[y] = std::numeric_limits<float>::infinity();
+                }
 
-                // Update energy with rolled LUT
-                (void)detail::roll_2d(luts, min_x, min_y, rolled_backing);
-                std::transform(energy_currents_backing.begin(), energy_currents_backing.end(), rolled_backing.begin(), energy_currents_backing.begin(),
-                    [](float a, float b) { return a + b; });
+                size_t const col{ kernels.add_min(energy_row, ws_.row_update_.data(), cols) };
+                if (energy_row[col] < min || i == 0)
+                {
+                    min = energy_row[col];
+                    ret = (i * cols) + col;
+                }
+            }
 
-                ret.samples.emplace_back(std::tuple{ min_x, min_y, input_img[min_x, min_y] });
+            return ret;
+        }
+    };
 
-                final_stipple[min_x, min_y] = dot_value;
+    /// @brief A void-and-cluster style rank map: the order in which the
+    /// greedy stippler places samples on a flat image of the given size.
+    ///
+    /// That order only depends on (size, sigma), so it can be computed once,
+    /// saved, and then used to stipple any image by thresholding in a single
+    /// parallel pass (see the stippled_image constructor that takes one).
+    /// The map tiles seamlessly, so it works for images of any size.
+    class blue_noise_rank_map
+    {
+        size_t size_;
+        std::vector<uint32_t> ranks_;
+    public:
+        /// @brief Builds the rank map by running the greedy stippler over a
+        /// flat size x size image until every pixel holds a sample.
+        explicit blue_noise_rank_map(size_t size, float sigma = 0.9f, float window_sigmas = 4.0f)
+            : size_{ size }, ranks_(size * size)
+        {
+            std::vector<float> flat(size * size, 0.0f);
+            stippler greedy{ std::mdspan{ flat.data(), size, size }, 1.0f, sigma, 0.0f, false, window_sigmas };
+            sample_spans const order{ greedy.step(greedy.sample_count()) };
+            for (size_t rank = 0; rank < order.size(); ++rank)
+            {
+                ranks_[(order.rows[rank] * size) + order.cols[rank]] = static_cast<uint32_t>(rank);
             }
+        }
+
+        /// @brief Loads a rank map previously obtained from ranks().
+        blue_noise_rank_map(size_t size, std::vector<uint32_t> ranks) : size_{ size }, ranks_{ std::move(ranks) }
+        {
+            assert(ranks_.size() == size_ * size_);
+        }
+
+        /// @brief Gets the width and height of the map.
+        [[nodiscard]] auto size() const -> size_t { return size_; }
+
+        /// @brief Gets the rank of every pixel, row-major, for saving.
+        [[nodiscard]] auto ranks() const -> std::span<uint32_t const> { return ranks_; }
+
+        /// @brief Gets the rank of a pixel as a fraction in (0, 1).
+        [[nodiscard]] auto threshold(size_t x, size_t y) const -> float
+        {
+            return (static_cast<float>(ranks_[((x % size_) * size_) + (y % size_)]) + 0.5f) / static_cast<float>(ranks_.size());
+        }
+    };
+
+    /// @brief How the greedy stippler stores its energy field and splat.
+    /// storage must order like the values it encodes, so the min index can
+    /// compare it directly, and equal values must encode the same. add sums
+    /// two stored values, and its row form adds a stored splat row into the
+    /// field; that is the kernel the placement loop runs. Infinity, which
+    /// marks placed samples, must survive encoding and adding any value.
+    template <typename Energy>
+    concept energy_format = requires(float value, typename Energy::storage stored, typename Energy::storage *dst, size_t n)
+    {
+        { Energy::encode(value) } -> std::same_as<typename Energy::storage>;
+        { Energy::decode(stored) } -> std::same_as<float>;
+        { Energy::add(stored, stored) } -> std::same_as<typename Energy::storage>;
+        { Energy::add(dst, dst, n) } -> std::same_as<void>;
+    };
+
+    /// @brief Energy as 32-bit floats, the same as the other constructors.
+    struct float_energy
+    {
+        using storage = float;
+
+        static auto encode(float value) -> float { return value; }
+        static auto decode(float stored) -> float { return stored; }
+        static auto add(float a, float b) -> float { return a + b; }
+        static auto add(float *dst, float const *src, size_t n) -> void { detail::simd::scalar::add(dst, src, n); }
+    };
+
+    /// @brief Energy as bfloat16, the top half of a float rounded to nearest
+    /// even: the float's range with 8 bits of precision. Stored with the
+    /// negative values' bits flipped so they order as unsigned integers, and
+    /// with -0 stored as +0 so zeros tie.
+    struct bfloat16_energy
+    {
+        using storage = uint16_t;
+
+        static auto encode(float value) -> uint16_t
+        {
+            uint32_t bits{ std::bit_cast<uint32_t>(value) };
+            bits += 0x7fffu + ((bits >> 16) & 1u);
+            uint32_t half{ bits >> 16 };
+            half = (half & 0x7fffu) == 0 ? 0 : half;
+            // Flip every bit of a negative value, only the sign otherwise.
+            // Branch-free, as splats mix signs.
+            return static_cast<uint16_t>(half ^ (0x8000u | (0u - (half >> 15))));
+        }
+
+        static auto decode(uint16_t stored) -> float
+        {
+            uint32_t const half{ stored ^ (0xffffu ^ ((uint32_t{ stored } >> 15) * 0x7fffu)) };
+            return std::bit_cast<float>(half << 16);
+        }
+
+        static auto add(uint16_t a, uint16_t b) -> uint16_t { return encode(decode(a) + decode(b)); }
+
+        // Branch-free, so the compiler vectorizes the conversions with the
+        // adds.
+        static auto add(uint16_t *dst, uint16_t const *src, size_t n) -> void
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                dst[j] = add(dst[j], src[j]);
+            }
+        }
+    };
+
+    /// @brief Energy as 16-bit fixed point in steps of 2^-FractionBits. The
+    /// default covers [-8, 8) in steps of about 2.4e-4, finer than bfloat16
+    /// and wide enough for images in [0, 1]. The largest code is infinity,
+    /// which absorbs whatever is added to it; finite sums saturate below
+    /// it.
+    template <int FractionBits = 12>
+    struct fixed16_energy
+    {
+        using storage = int16_t;
+
+        static constexpr float scale{ static_cast<float>(1 << FractionBits) };
+        static constexpr int32_t infinite{ std::numeric_limits<int16_t>::max() };
+
+        static auto encode(float value) -> int16_t
+        {
+            if (value == std::numeric_limits<float>::infinity())
+            {
+                return infinite;
+            }
+
+            float const scaled{ std::clamp(std::nearbyint(value * scale), static_cast<float>(std::numeric_limits<int16_t>::min()), static_cast<float>(infinite - 1)) };
+            return static_cast<int16_t>(scaled);
+        }
+
+        static auto decode(int16_t stored) -> float
+        {
+            return stored == infinite ? std::numeric_limits<float>::infinity() : static_cast<float>(stored) / scale;
+        }
+
+        static auto add(int16_t a, int16_t b) -> int16_t
+        {
+            int32_t const sum{ std::clamp<int32_t>(int32_t{ a } + int32_t{ b }, std::numeric_limits<int16_t>::min(), infinite - 1) };
+            return static_cast<int16_t>(a == infinite || b == infinite ? infinite : sum);
+        }
+
+        // Branch-free, so the compiler vectorizes it.
+        static auto add(int16_t *dst, int16_t const *src, size_t n) -> void
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                dst[j] = add(dst[j], src[j]);
+            }
+        }
+    };
+
+    /// @brief Selects the energy_format of the stippled_image constructor
+    /// that takes it.
+    template <energy_format Energy>
+    struct precision
+    {
+    };
+
+    /// @brief Options for coarse to fine stippling. See the stippled_image
+    /// constructor that takes them.
+    struct pyramid
+    {
+        /// @brief How many times the image is halved for the coarsest level.
+        size_t levels{ 2 };
+    };
+
+    /// @brief Options for batched greedy stippling. See the stippled_image
+    /// constructor that takes them.
+    struct batched
+    {
+        /// @brief The most samples placed per iteration. 1 is the plain
+        /// stippler.
+        size_t samples{ 16 };
+    };
+
+    class stippled_image
+    {
+        detail::stipple_data data_;
+    public:
+        /// @brief Stipples the given image.
+        /// @param window_sigmas Each sample only updates the energy within
+        ///     window_sigmas * sigma pixels of it. See stippler.
+        explicit stippled_image(
+            float_2d_span auto input_img, 
+            float percentage = 0.33f,
+            float sigma = 0.9f,
+            float content_bias = 0.5f,
+            bool negate = false,
+            float window_sigmas = 4.0f) : stippled_image(stippler{ input_img, percentage, sigma, content_bias, negate, window_sigmas })
+        {
+        }
+
+        /// @brief Stipples the given image by thresholding against a rank map
+        /// instead of running the greedy placement.
+        ///
+        /// At equilibrium the greedy stippler leaves the energy about flat, so
+        /// a pixel's dot density is about percentage + content_bias *
+        /// (mean - value), flipped for negate. A pixel gets a dot when its
+        /// rank falls below that density. The samples are listed row-major.
+        stippled_image(
+            blue_noise_rank_map const &ranks,
+            float_2d_span auto input_img,
+            float percentage = 0.33f,
+            float content_bias = 0.5f,
+            bool negate = false) : data_{ threshold_backing(ranks, input_img, percentage, content_bias, negate) }
+        {
+        }
+
+        /// @brief Stipples the given image on all cores by splitting it into
+        /// tiles that share one energy field.
+        ///
+        /// The tiles are four-colored so same-colored tiles are at least one
+        /// window apart; each phase places samples in every tile of one color
+        /// in parallel, so no two tiles touch the same energy. Each tile gets
+        /// a share of the samples proportional to its expected dot density,
+        /// placed over several rounds of the four colors so neighbouring tiles
+        /// see each other's dots. The result is deterministic but not
+        /// identical to the serial stipple.
+        /// @param tile_size The smallest tile edge, in pixels. Tiles are never
+        ///     narrower than the energy window.
+        stippled_image(
+            std::execution::parallel_policy const &,
+            float_2d_span auto input_img,
+            float percentage = 0.33f,
+            float sigma = 0.9f,
+            float content_bias = 0.5f,
+            bool negate = false,
+            float window_sigmas = 4.0f,
+            size_t tile_size = 64) : data_{ tiled_backing(input_img, percentage, sigma, content_bias, negate, window_sigmas, tile_size) }
+        {
+        }
+
+        /// @brief Stipples the given image in the buffers of a reusable
+        /// workspace, allocating the result from the given memory resource.
+        ///
+        /// The result is the same as the plain constructor's. Once the
+        /// workspace has seen an image at least this large the only
+        /// allocations are the mask and samples, so with a resource such as a
+        /// std::pmr::monotonic_buffer_resource over a reused buffer, repeated
+        /// stippling does not touch the heap. The image must be destroyed
+        /// before the resource releases its memory.
+        stippled_image(
+            stipple_workspace &workspace,
+            float_2d_span auto input_img,
+            float percentage = 0.33f,
+            float sigma = 0.9f,
+            float content_bias = 0.5f,
+            bool negate = false,
+            float window_sigmas = 4.0f,
+            std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+            : data_{ stippler{ std::move(workspace), input_img, percentage, sigma, content_bias, negate, window_sigmas, resource }.finish(workspace) }
+        {
+        }
+
+        /// @brief Stipples the given image coarse to fine.
+        ///
+        /// The image is halved options.levels times. Samples are first placed
+        /// greedily on the coarsest level, where a cell takes as many samples
+        /// as it has pixels and a sample adds the Gaussian mass of sigma
+        /// scaled to the level, spread over the cell's pixels. Every finer
+        /// level then takes the samples in the same order and puts each in
+        /// whichever child of its cell has room and the lowest energy, down to
+        /// single pixels. Only the coarsest level is searched, so a sample
+        /// costs a small window and four comparisons per finer level instead
+        /// of a full-resolution index update. The result keeps the blue noise
+        /// character but differs from the plain stipple. Levels too small for
+        /// their energy window are dropped; with none left, or window_sigmas
+        /// <= 0, this is the plain stippler.
+        stippled_image(
+            pyramid const &options,
+            float_2d_span auto input_img,
+            float percentage = 0.33f,
+            float sigma = 0.9f,
+            float content_bias = 0.5f,
+            bool negate = false,
+            float window_sigmas = 4.0f) : data_{ pyramid_backing(options, input_img, percentage, sigma, content_bias, negate, window_sigmas) }
+        {
+        }
+
+        /// @brief Stipples the given image placing several samples per
+        /// iteration.
+        ///
+        /// The image is split into buckets, about four per sample of a
+        /// batch, each with its own min index. Every iteration takes the
+        /// minimum of each bucket and, lowest energy first, keeps up to
+        /// options.samples of them that are at least a window apart. Their
+        /// splats cannot overlap, so they are added on all cores, and so are
+        /// the index updates, one task per touched bucket. A sample only
+        /// misses the energy of the others in its batch, which are far away,
+        /// so the result is close to the plain stipple in quality but not
+        /// identical to it. The result is deterministic. options.samples of
+        /// 1, window_sigmas <= 0, or an image too small for the window give
+        /// the plain stipple.
+        stippled_image(
+            batched const &options,
+            float_2d_span auto input_img,
+            float percentage = 0.33f,
+            float sigma = 0.9f,
+            float content_bias = 0.5f,
+            bool negate = false,
+            float window_sigmas = 4.0f) : data_{ batched_backing(options, input_img, percentage, sigma, content_bias, negate, window_sigmas) }
+        {
+        }
+
+        /// @brief Stipples the given image greedily with the energy field and
+        /// splat stored in the given format.
+        ///
+        /// A 16-bit format halves the memory the placement loop streams
+        /// through, the field and its min index, so images twice the area
+        /// stay in cache, at the cost of rounding every update. Samples land
+        /// near, but not always on, the plain stipple's; braille_bench
+        /// reports how many move. precision<float_energy> gives the plain
+        /// stipple. Needs a windowed update: window_sigmas <= 0, an image
+        /// too small for the window, or one of 2^32 pixels or more, gives
+        /// the plain stipple.
+        template <typename Energy>
+        stippled_image(
+            precision<Energy>,
+            float_2d_span auto input_img,
+            float percentage = 0.33f,
+            float sigma = 0.9f,
+            float content_bias = 0.5f,
+            bool negate = false,
+            float window_sigmas = 4.0f) : data_{ precision_backing<Energy>(input_img, percentage, sigma, content_bias, negate, window_sigmas) }
+        {
+        }
+
+        /// @brief Finishes a progressive stipple, keeping its result.
+        template <float_2d_span Input>
+        explicit stippled_image(stippler<Input> &&progressive) : data_{ std::move(progressive).finish() }
+        {
+        }
+
+        /// @brief Stipples a batch of images on all cores, one image per task.
+        ///
+        /// Images are spread over the parallel algorithms' work-stealing
+        /// pool. Each running task borrows a workspace reserved for the
+        /// largest image, so past the first image per worker nothing but the
+        /// results is allocated. Each image is stippled exactly as the
+        /// single image constructor would.
+        /// @param images A random access range of 2D mdspans of float.
+        /// @return The stippled images, in the order of images.
+        template <std::ranges::random_access_range Images>
+            requires float_2d_span<std::ranges::range_value_t<Images>>
+        [[nodiscard]] static auto batch(
+            Images const &images,
+            float percentage = 0.33f,
+            float sigma = 0.9f,
+            float content_bias = 0.5f,
+            bool negate = false,
+            float window_sigmas = 4.0f) -> std::vector<stippled_image>
+        {
+            size_t const count{ static_cast<size_t>(std::ranges::size(images)) };
+            size_t largest{ 0 };
+            for (auto const &image : images)
+            {
+                largest = std::max(largest, image.extent(0) * image.extent(1));
+            }
+
+            detail::workspace_pool pool{ largest };
+            std::vector<detail::stipple_data> results(count);
+            std::vector<size_t> indices(count);
+            std::ranges::iota(indices, 0);
+            std::for_each(
+                std::execution::par,
+                indices.begin(), indices.end(),
+                [&](size_t i)
+                {
+                    stipple_workspace workspace{ pool.acquire() };
+                    stippler progressive{ std::move(workspace), std::ranges::begin(images)[static_cast<std::ranges::range_difference_t<Images>>(i)],
+                        percentage, sigma, content_bias, negate, window_sigmas };
+                    results[i] = std::move(progressive).finish(workspace);
+                    pool.release(std::move(workspace));
+                });
+
+            std::vector<stippled_image> ret;
+            ret.reserve(count);
+            for (detail::stipple_data &result : results)
+            {
+                ret.push_back(stippled_image{ std::move(result) });
+            }
+
+            return ret;
+        }
+
+        /// @brief Gets the stippled image.
+        /// @return The stippled image.
+        [[nodiscard]] auto stippled() const -> bit_mask::view_type { return data_.mask.view(); }
+
+        /// @brief Gets the bit-packed stippled image.
+        [[nodiscard]] auto mask() const -> bit_mask const & { return data_.mask; }
+
+        /// @brief Gets the samples used to create the stippled image.
+        /// @return The samples used to create the stippled image, viewing
+        ///     storage owned by this image.
+        [[nodiscard]] auto samples() const -> sample_spans { return data_.spans(); }
+
+        /// @brief Gets where the stippling time went. Zero unless BRMA_STATS
+        /// is 1. The tiled and rank map constructors time their setup and
+        /// their placement as a whole, as update.
+        [[nodiscard]] auto stats() const -> stipple_stats const & { return data_.stats; }
+    private:
+        explicit stippled_image(detail::stipple_data data) : data_{ std::move(data) }
+        {
+        }
+
+        // A tiling of one dimension into count tiles. The count is even so the
+        // first and last tiles, which touch across the wrap, differ in color.
+        struct tile_split
+        {
+            size_t count;
+            size_t extent;
+
+            tile_split(size_t length, size_t tile_size) : count{ std::max<size_t>(1, length / tile_size) }, extent{ length }
+            {
+                if (count > 1 && count % 2 != 0)
+                {
+                    --count;
+                }
+            }
+
+            [[nodiscard]] auto begin(size_t tile) const -> size_t { return tile * extent / count; }
+            [[nodiscard]] auto end(size_t tile) const -> size_t { return (tile + 1) * extent / count; }
+        };
+
+        static auto tiled_backing(
+            float_2d_span auto input_img,
+            float percentage,
+            float sigma,
+            float content_bias,
+            bool negate,
+            float window_sigmas,
+            size_t tile_size) -> detail::stipple_data
+        {
+            size_t const rows{ input_img.extent(0) };
+            size_t const cols{ input_img.extent(1) };
+            size_t const radius{ detail::window_radius(rows, cols, sigma, window_sigmas) };
+            tile_split const row_tiles{ rows, std::max(tile_size, (2 * radius) + 1) };
+            tile_split const col_tiles{ cols, std::max(tile_size, (2 * radius) + 1) };
+            if (radius == 0 || row_tiles.count * col_tiles.count == 1)
+            {
+                return stippler{ input_img, percentage, sigma, content_bias, negate, window_sigmas }.finish();
+            }
+
+            stipple_stats stats;
+            detail::phase_timer setup_timer{ stats.setup };
+
+            struct tile
+            {
+                size_t row0;
+                size_t col0;
+                size_t rows;
+                size_t cols;
+                size_t quota;
+                std::vector<std::tuple<size_t, size_t, float>> samples;
+            };
+
+            // Weigh each tile by its expected dot count, the same density the
+            // rank map thresholds against, and split the samples by largest
+            // remainder.
+            float const mean{ detail::mean_value(input_img) };
+            float const bias{ negate ? -content_bias : content_bias };
+            std::vector<tile> tiles;
+            std::vector<double> weights;
+            for (size_t ti = 0; ti < row_tiles.count; ++ti)
+            {
+                for (size_t tj = 0; tj < col_tiles.count; ++tj)
+                {
+                    tile t{ row_tiles.begin(ti), col_tiles.begin(tj), row_tiles.end(ti) - row_tiles.begin(ti), col_tiles.end(tj) - col_tiles.begin(tj), 0, {} };
+                    double weight{ 0.0 };
+                    for (size_t i = t.row0; i < t.row0 + t.rows; ++i)
+                    {
+                        for (size_t j = t.col0; j < t.col0 + t.cols; ++j)
+                        {
+                            weight += static_cast<double>(std::clamp(percentage + (bias * (mean - input_img[i, j])), 0.0f, 1.0f));
+                        }
+                    }
+
+                    tiles.push_back(std::move(t));
+                    weights.push_back(weight);
+                }
+            }
+
+            // A tile takes no more samples than it has pixels. What a full
+            // tile cannot take is split again over the tiles with room, by
+            // weight, or by area when they all weigh nothing, until every
+            // sample has a tile or every tile is full.
+            auto const sample_count{ static_cast<size_t>(static_cast<float>(rows * cols) * percentage) };
+            size_t remaining{ sample_count };
+            std::vector<std::pair<double, size_t>> remainders;
+            while (remaining > 0)
+            {
+                double open_weight{ 0.0 };
+                size_t open_area{ 0 };
+                for (size_t t = 0; t < tiles.size(); ++t)
+                {
+                    if (tiles[t].quota < tiles[t].rows * tiles[t].cols)
+                    {
+                        open_weight += weights[t];
+                        open_area += tiles[t].rows * tiles[t].cols;
+                    }
+                }
+
+                if (open_area == 0)
+                {
+                    break;
+                }
+
+                remainders.clear();
+                size_t assigned{ 0 };
+                std::vector<size_t> shares(tiles.size(), 0);
+                for (size_t t = 0; t < tiles.size(); ++t)
+                {
+                    if (tiles[t].quota == tiles[t].rows * tiles[t].cols)
+                    {
+                        continue;
+                    }
+
+                    double const share{ open_weight > 0.0
+                        ? static_cast<double>(remaining) * weights[t] / open_weight
+                        : static_cast<double>(remaining * tiles[t].rows * tiles[t].cols) / static_cast<double>(open_area) };
+                    shares[t] = static_cast<size_t>(share);
+                    assigned += shares[t];
+                    remainders.emplace_back(-(share - static_cast<double>(shares[t])), t);
+                }
+
+                std::ranges::sort(remainders);
+                for (size_t k = 0; assigned < remaining && k < remainders.size(); ++k, ++assigned)
+                {
+                    ++shares[remainders[k].second];
+                }
+
+                for (size_t t = 0; t < tiles.size(); ++t)
+                {
+                    size_t const taken{ std::min(shares[t], (tiles[t].rows * tiles[t].cols) - tiles[t].quota) };
+                    tiles[t].quota += taken;
+                    remaining -= taken;
+                }
+            }
+
+            detail::stipple_data ret{ detail::init_data(rows, cols, negate) };
+            std::vector<float> energy{ detail::init_energy(input_img, content_bias, negate) };
+            std::vector<float> const window{ detail::splat_window(sigma, radius) };
+            std::array<std::vector<tile *>, 4> colors;
+            for (size_t ti = 0; ti < row_tiles.count; ++ti)
+            {
+                for (size_t tj = 0; tj < col_tiles.count; ++tj)
+                {
+                    colors[((ti % 2) * 2) + (tj % 2)].push_back(&tiles[(ti * col_tiles.count) + tj]);
+                }
+            }
+
+            // Each tile indexes and places samples only in its own pixels, so
+            // its window writes reach at most radius into its neighbours,
+            // which are a different color.
+            setup_timer.stop();
+            detail::phase_timer update_timer{ stats.update };
+            constexpr size_t rounds{ 4 };
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                for (auto const &color : colors)
+                {
+                    std::for_each(
+                        std::execution::par,
+                        color.begin(), color.end(),
+                        [&, round](tile *t)
+                        {
+                            size_t const count{ (t->quota * (round + 1) / rounds) - (t->quota * round / rounds) };
+                            if (count == 0)
+                            {
+                                return;
+                            }
+
+                            detail::min_index index{ energy.data() + (t->row0 * cols) + t->col0, t->rows, t->cols, cols };
+                            for (size_t iter = 0; iter < count; ++iter)
+                            {
+                                auto [min_x, min_y] = index.argmin();
+                                min_x += t->row0;
+                                min_y += t->col0;
+                                detail::add_window(energy.data(), rows, cols, window, min_x, min_y, radius);
+                                detail::update_window(index, rows, cols, min_x, min_y, radius, t->row0, t->col0);
+                                t->samples.emplace_back(std::tuple{ min_x, min_y, input_img[min_x, min_y] });
+                            }
+                        });
+
+                    // Tiles can share mask words, so the dots are marked here.
+                    for (tile *t : color)
+                    {
+                        for (auto const &[x, y, value] : t->samples)
+                        {
+                            ret.mask.set(x, y, !negate);
+                            ret.push_back(x, y, value);
+                        }
+
+                        t->samples.clear();
+                    }
+                }
+            }
+
+            update_timer.stop();
+            detail::add_stat(stats.iterations, ret.size());
+            ret.stats = stats;
+            return ret;
+        }
+
+        static auto pyramid_backing(
+            pyramid const &options,
+            float_2d_span auto input_img,
+            float percentage,
+            float sigma,
+            float content_bias,
+            bool negate,
+            float window_sigmas) -> detail::stipple_data
+        {
+            // One level per halving, finest first. Cells of level l cover up
+            // to 2^l x 2^l pixels. Energies are per pixel of the cell, and a
+            // full cell's energy is infinite.
+            struct level
+            {
+                size_t rows;
+                size_t cols;
+                size_t radius;
+                std::vector<float> energy;
+                std::vector<size_t> room;
+                std::vector<float> window;
+            };
+
+            stipple_stats stats;
+            detail::phase_timer setup_timer{ stats.setup };
+            size_t const rows{ input_img.extent(0) };
+            size_t const cols{ input_img.extent(1) };
+            std::vector<level> levels;
+            for (size_t l = 0, scale = 1; l <= options.levels; ++l, scale *= 2)
+            {
+                size_t const level_rows{ (rows + scale - 1) / scale };
+                size_t const level_cols{ (cols + scale - 1) / scale };
+                float const level_sigma{ sigma / static_cast<float>(scale) };
+                size_t const radius{ detail::window_radius(level_rows, level_cols, level_sigma, window_sigmas) };
+                if (radius == 0)
+                {
+                    break;
+                }
+
+                level lv{ level_rows, level_cols, radius, {}, std::vector<size_t>(level_rows * level_cols), detail::splat_window(level_sigma, radius) };
+                for (size_t x = 0; x < level_rows; ++x)
+                {
+                    for (size_t y = 0; y < level_cols; ++y)
+                    {
+                        lv.room[(x * level_cols) + y] = std::min(scale, rows - (x * scale)) * std::min(scale, cols - (y * scale));
+                    }
+                }
+
+                if (l == 0)
+                {
+                    detail::init_energy(input_img, content_bias, negate, lv.energy);
+                }
+                else
+                {
+                    // The mean of the children's starting energies, and a
+                    // splat whose center cell can take more samples.
+                    level const &child{ levels.back() };
+                    lv.energy.assign(level_rows * level_cols, 0.0f);
+                    for (size_t x = 0; x < child.rows; ++x)
+                    {
+                        for (size_t y = 0; y < child.cols; ++y)
+                        {
+                            lv.energy[((x / 2) * level_cols) + (y / 2)] += child.energy[(x * child.cols) + y] * static_cast<float>(child.room[(x * child.cols) + y]);
+                        }
+                    }
+
+                    for (size_t cell = 0; cell < lv.energy.size(); ++cell)
+                    {
+                        lv.energy[cell] /= static_cast<float>(lv.room[cell]);
+                    }
+
+                    float const center{ detail::gauss_small_sigma(0.0f, level_sigma) };
+                    lv.window[(radius * ((2 * radius) + 1)) + radius] = center * center;
+                    float const per_pixel{ 1.0f / static_cast<float>(scale * scale) };
+                    std::ranges::transform(lv.window, lv.window.begin(), [per_pixel](float w) { return w * per_pixel; });
+                }
+
+                levels.push_back(std::move(lv));
+            }
+
+            if (levels.size() < 2)
+            {
+                return stippler{ input_img, percentage, sigma, content_bias, negate, window_sigmas }.finish();
+            }
+
+            auto const sample_count{ static_cast<size_t>(static_cast<float>(rows * cols) * percentage) };
+            auto const place = [](level &lv, size_t cell)
+                {
+                    detail::add_window(lv.energy.data(), lv.rows, lv.cols, lv.window, cell / lv.cols, cell % lv.cols, lv.radius);
+                    if (--lv.room[cell] == 0)
+                    {
+                        lv.energy[cell] = std::numeric_limits<float>::infinity();
+                    }
+                };
+
+            // Greedy placement on the coarsest level, remembering the cells.
+            level &top{ levels.back() };
+            detail::min_index index{ top.energy.data(), top.rows, top.cols, top.cols };
+            setup_timer.stop();
+            detail::phase_timer update_timer{ stats.update };
+            std::vector<size_t> order(sample_count);
+            for (size_t &cell : order)
+            {
+                auto const [x, y] = index.argmin();
+                cell = (x * top.cols) + y;
+                place(top, cell);
+                detail::update_window(index, top.rows, top.cols, x, y, top.radius);
+            }
+
+            // Each finer level moves every sample into the best child of its
+            // cell, in the coarse placement order.
+            for (size_t l = levels.size() - 1; l-- > 0;)
+            {
+                level &lv{ levels[l] };
+                size_t const parent_cols{ levels[l + 1].cols };
+                for (size_t &cell : order)
+                {
+                    size_t const x0{ (cell / parent_cols) * 2 };
+                    size_t const y0{ (cell % parent_cols) * 2 };
+                    size_t best{ lv.energy.size() };
+                    for (size_t x = x0; x < std::min(x0 + 2, lv.rows); ++x)
+                    {
+                        for (size_t y = y0; y < std::min(y0 + 2, lv.cols); ++y)
+                        {
+                            size_t const child{ (x * lv.cols) + y };
+                            if (lv.room[child] != 0 && (best == lv.energy.size() || lv.energy[child] < lv.energy[best]))
+                            {
+                                best = child;
+                            }
+                        }
+                    }
+
+                    assert(best != lv.energy.size());
+                    cell = best;
+                    place(lv, cell);
+                }
+            }
+
+            detail::stipple_data ret{ detail::init_data(rows, cols, negate) };
+            ret.reserve(sample_count);
+            for (size_t const pixel : order)
+            {
+                ret.push_back(pixel / cols, pixel % cols, input_img[pixel / cols, pixel % cols]);
+                ret.mask.set(pixel / cols, pixel % cols, !negate);
+            }
+
+            update_timer.stop();
+            detail::add_stat(stats.iterations, sample_count);
+            ret.stats = stats;
+            return ret;
+        }
+
+        static auto batched_backing(
+            batched const &options,
+            float_2d_span auto input_img,
+            float percentage,
+            float sigma,
+            float content_bias,
+            bool negate,
+            float window_sigmas) -> detail::stipple_data
+        {
+            size_t const rows{ input_img.extent(0) };
+            size_t const cols{ input_img.extent(1) };
+            size_t const radius{ detail::window_radius(rows, cols, sigma, window_sigmas) };
+            if (radius == 0 || options.samples <= 1)
+            {
+                return stippler{ input_img, percentage, sigma, content_bias, negate, window_sigmas }.finish();
+            }
+
+            stipple_stats stats;
+            detail::phase_timer setup_timer{ stats.setup };
+
+            // About four buckets per sample of a batch, so there are enough
+            // far apart minima to choose from, each at least a window wide so
+            // a splat touches at most four of them.
+            size_t const width{ (2 * radius) + 1 };
+            auto const per_axis{ 2 * static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(options.samples)))) };
+            tile_split const row_buckets{ rows, std::max(width, rows / per_axis) };
+            tile_split const col_buckets{ cols, std::max(width, cols / per_axis) };
+            std::vector<size_t> row_bucket(rows);
+            std::vector<size_t> col_bucket(cols);
+            for (size_t b = 0; b < row_buckets.count; ++b)
+            {
+                std::fill(row_bucket.begin() + static_cast<ptrdiff_t>(row_buckets.begin(b)), row_bucket.begin() + static_cast<ptrdiff_t>(row_buckets.end(b)), b);
+            }
+
+            for (size_t b = 0; b < col_buckets.count; ++b)
+            {
+                std::fill(col_bucket.begin() + static_cast<ptrdiff_t>(col_buckets.begin(b)), col_bucket.begin() + static_cast<ptrdiff_t>(col_buckets.end(b)), b);
+            }
+
+            std::vector<float> energy{ detail::init_energy(input_img, content_bias, negate) };
+            std::vector<float> const window{ detail::splat_window(sigma, radius) };
+            std::vector<detail::min_index> indexes(row_buckets.count * col_buckets.count);
+            for (size_t b = 0; b < indexes.size(); ++b)
+            {
+                size_t const bi{ b / col_buckets.count };
+                size_t const bj{ b % col_buckets.count };
+                indexes[b].reset(energy.data() + (row_buckets.begin(bi) * cols) + col_buckets.begin(bj),
+                    row_buckets.end(bi) - row_buckets.begin(bi), col_buckets.end(bj) - col_buckets.begin(bj), cols);
+            }
+
+            // Windows are disjoint when their centers are a window apart
+            // along either axis, around the wrap.
+            auto const apart = [rows, cols, width](size_t a, size_t b)
+                {
+                    size_t const di{ a / cols > b / cols ? (a / cols) - (b / cols) : (b / cols) - (a / cols) };
+                    size_t const dj{ a % cols > b % cols ? (a % cols) - (b % cols) : (b % cols) - (a % cols) };
+                    return std::min(di, rows - di) >= width || std::min(dj, cols - dj) >= width;
+                };
+
+            auto const sample_count{ static_cast<size_t>(static_cast<float>(rows * cols) * percentage) };
+            detail::stipple_data ret{ detail::init_data(rows, cols, negate) };
+            ret.reserve(sample_count);
+            std::vector<std::pair<float, size_t>> candidates(indexes.size());
+            std::vector<size_t> picked;
+            std::vector<std::vector<size_t>> touched(indexes.size());
+            std::vector<size_t> touched_buckets;
+            setup_timer.stop();
+            while (ret.size() < sample_count)
+            {
+                // Ties go to the lowest row-major position, as in the plain
+                // stippler; a bucket's first minimum is also its lowest.
+                detail::phase_timer argmin_timer{ stats.argmin };
+                for (size_t b = 0; b < indexes.size(); ++b)
+                {
+                    auto const [x, y] = indexes[b].argmin();
+                    size_t const pos{ ((row_buckets.begin(b / col_buckets.count) + x) * cols) + col_buckets.begin(b % col_buckets.count) + y };
+                    candidates[b] = { energy[pos], pos };
+                }
+
+                std::ranges::sort(candidates);
+                picked.clear();
+                size_t const batch{ std::min(options.samples, sample_count - ret.size()) };
+                // Full buckets offer a placed pixel at infinity; sorted last,
+                // they end the batch. Some bucket still has room while
+                // samples are left, so the batch is never empty.
+                for (auto const &[value, pos] : candidates)
+                {
+                    if (picked.size() == batch || value == std::numeric_limits<float>::infinity())
+                    {
+                        break;
+                    }
+
+                    if (std::ranges::all_of(picked, [&apart, pos](size_t other) { return apart(pos, other); }))
+                    {
+                        picked.push_back(pos);
+                    }
+                }
+
+                argmin_timer.stop();
+                detail::phase_timer const update_timer{ stats.update };
+                std::for_each(
+                    std::execution::par,
+                    picked.begin(), picked.end(),
+                    [&](size_t pos)
+                    {
+                        detail::add_window(energy.data(), rows, cols, window, pos / cols, pos % cols, radius);
+                    });
+
+                // A window spans at most two buckets each way: those of its
+                // first and last row and column.
+                touched_buckets.clear();
+                for (size_t const pos : picked)
+                {
+                    size_t const x{ pos / cols };
+                    size_t const y{ pos % cols };
+                    std::array const bis{ row_bucket[(x + rows - radius) % rows], row_bucket[(x + radius) % rows] };
+                    std::array const bjs{ col_bucket[(y + cols - radius) % cols], col_bucket[(y + radius) % cols] };
+                    for (size_t const bi : std::span{ bis.data(), bis[0] == bis[1] ? 1u : 2u })
+                    {
+                        for (size_t const bj : std::span{ bjs.data(), bjs[0] == bjs[1] ? 1u : 2u })
+                        {
+                            size_t const b{ (bi * col_buckets.count) + bj };
+                            if (touched[b].empty())
+                            {
+                                touched_buckets.push_back(b);
+                            }
+
+                            touched[b].push_back(pos);
+                        }
+                    }
+                }
+
+                std::for_each(
+                    std::execution::par,
+                    touched_buckets.begin(), touched_buckets.end(),
+                    [&](size_t b)
+                    {
+                        size_t const row0{ row_buckets.begin(b / col_buckets.count) };
+                        size_t const col0{ col_buckets.begin(b % col_buckets.count) };
+                        for (size_t const pos : touched[b])
+                        {
+                            detail::update_window(indexes[b], rows, cols, pos / cols, pos % cols, radius, row0, col0);
+                        }
+
+                        touched[b].clear();
+                    });
+
+                for (size_t const pos : picked)
+                {
+                    ret.push_back(pos / cols, pos % cols, input_img[pos / cols, pos % cols]);
+                    ret.mask.set(pos / cols, pos % cols, !negate);
+                }
+            }
+
+            detail::add_stat(stats.iterations, ret.size());
+            ret.stats = stats;
+            return ret;
+        }
+
+        template <typename Energy>
+        static auto precision_backing(
+            float_2d_span auto input_img,
+            float percentage,
+            float sigma,
+            float content_bias,
+            bool negate,
+            float window_sigmas) -> detail::stipple_data
+        {
+            size_t const rows{ input_img.extent(0) };
+            size_t const cols{ input_img.extent(1) };
+            size_t const radius{ detail::window_radius(rows, cols, sigma, window_sigmas) };
+            if (radius == 0 || rows * cols > std::numeric_limits<typename detail::basic_min_index<typename Energy::storage>::position>::max())
+            {
+                return stippler{ input_img, percentage, sigma, content_bias, negate, window_sigmas }.finish();
+            }
+
+            // The same starting energy and splat as the plain stippler,
+            // encoded. Multiplying by the sign is exact, so float_energy
+            // matches it bit for bit.
+            stipple_stats stats;
+            detail::phase_timer setup_timer{ stats.setup };
+            float const sign{ negate ? -1.0f : 1.0f };
+            std::vector<typename Energy::storage> energy(rows * cols);
+            for (size_t i = 0; i < rows; ++i)
+            {
+                for (size_t j = 0; j < cols; ++j)
+                {
+                    energy[(i * cols) + j] = Energy::encode(input_img[i, j] * content_bias * sign);
+                }
+            }
+
+            std::vector<float> const splat{ detail::splat_window(sigma, radius) };
+            std::vector<typename Energy::storage> window(splat.size());
+            std::ranges::transform(splat, window.begin(), [](float w) { return Energy::encode(w); });
+            detail::basic_min_index<typename Energy::storage> index{ energy.data(), rows, cols, cols };
+            auto const sample_count{ static_cast<size_t>(static_cast<float>(rows * cols) * percentage) };
+            detail::stipple_data ret{ detail::init_data(rows, cols, negate) };
+            ret.reserve(sample_count);
+            setup_timer.stop();
+            for (size_t iter = 0; iter < sample_count; ++iter)
+            {
+                detail::phase_timer argmin_timer{ stats.argmin };
+                auto const [min_x, min_y] = index.argmin();
+                argmin_timer.stop();
+                detail::phase_timer const update_timer{ stats.update };
+                detail::add_window<Energy>(energy.data(), rows, cols, window, min_x, min_y, radius);
+                detail::update_window(index, rows, cols, min_x, min_y, radius);
+                ret.push_back(min_x, min_y, input_img[min_x, min_y]);
+                ret.mask.set(min_x, min_y, !negate);
+            }
+
+            detail::add_stat(stats.iterations, ret.size());
+            ret.stats = stats;
+            return ret;
+        }
+
+        static auto threshold_backing(
+            blue_noise_rank_map const &ranks,
+            float_2d_span auto input_img,
+            float percentage,
+            float content_bias,
+            bool negate) -> detail::stipple_data
+        {
+            stipple_stats stats;
+            detail::phase_timer setup_timer{ stats.setup };
+            bool const dot_value{ !negate };
+            detail::stipple_data ret{ detail::init_data(input_img.extent(0), input_img.extent(1), negate) };
+            float const mean{ detail::mean_value(input_img) };
+            setup_timer.stop();
+            detail::phase_timer update_timer{ stats.update };
+            std::vector<size_t> rows(ret.mask.rows());
+            std::ranges::iota(rows, 0);
+
+            // Mark the dots and count them per row, then lay the samples out
+            // row-major from the running count. Mask rows start on a word
+            // boundary, so rows can be marked in parallel.
+            float const bias{ negate ? -content_bias : content_bias };
+            std::vector<size_t> row_counts(ret.mask.rows() + 1, 0);
+            std::for_each(
+                std::execution::par,
+                rows.begin(), rows.end(),
+                [&](size_t row)
+                {
+                    for (size_t col = 0; col < ret.mask.cols(); ++col)
+                    {
+                        float const density{ percentage + (bias * (mean - input_img[row, col])) };
+                        if (ranks.threshold(row, col) < density)
+                        {
+                            ret.mask.set(row, col, dot_value);
+                            ++row_counts[row + 1];
+                        }
+                    }
+                });
+
+            std::inclusive_scan(row_counts.begin(), row_counts.end(), row_counts.begin());
+            ret.resize(row_counts.back());
+            std::for_each(
+                std::execution::par,
+                rows.begin(), rows.end(),
+                [&](size_t row)
+                {
+                    size_t sample{ row_counts[row] };
+                    for (size_t col = 0; col < ret.mask.cols(); ++col)
+                    {
+                        if (ret.mask[row, col] == dot_value)
+                        {
+                            ret.rows[sample] = static_cast<uint32_t>(row);
+                            ret.cols[sample] = static_cast<uint32_t>(col);
+                            ret.values[sample++] = input_img[row, col];
+                        }
+                    }
+                });
 
+            update_timer.stop();
+            detail::add_stat(stats.iterations, ret.size());
+            ret.stats = stats;
             return ret;
         }
     };
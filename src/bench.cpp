@@ -0,0 +1,401 @@
+// Benchmarks for stippling and braille encoding. Images and masks are
+// synthetic, so no assets are needed. Results are written as JSON:
+//
+//   braille_bench [--out results.json] [--filter text] [--max-size n] [--min-time seconds]
+#include <algorithm>
+#include <array>
+#include <braille_based_image.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <fmt/format.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mdspan>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <stippled_image.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    struct options
+    {
+        std::string out;
+        std::string filter;
+        size_t max_size{ 2048 };
+        double min_time{ 0.5 };
+    };
+
+    struct result
+    {
+        std::string name;
+        std::string group;
+        std::vector<std::pair<std::string, std::string>> params;
+        std::vector<double> times;
+        size_t items{ 0 };
+        std::vector<std::pair<std::string, double>> metrics;
+    };
+
+    // A smooth gradient with some ripples, in [0, 1].
+    auto synthetic_image(size_t rows, size_t cols) -> std::vector<float>
+    {
+        std::vector<float> ret(rows * cols);
+        for (size_t i = 0; i < rows; ++i)
+        {
+            for (size_t j = 0; j < cols; ++j)
+            {
+                float const y{ static_cast<float>(i) / static_cast<float>(rows) };
+                float const x{ static_cast<float>(j) / static_cast<float>(cols) };
+                float const ripple{ std::sin(x * 25.0f) * std::cos(y * 17.0f) };
+                float const radial{ std::hypot(x - 0.5f, y - 0.5f) };
+                ret[(i * cols) + j] = std::clamp(0.5f + (0.25f * ripple) - (0.5f * radial) + (0.25f * x), 0.0f, 1.0f);
+            }
+        }
+
+        return ret;
+    }
+
+    // About a third of the pixels set, from a fixed-seed xorshift.
+    auto synthetic_mask(size_t rows, size_t cols) -> std::unique_ptr<bool[]>
+    {
+        auto ret{ std::make_unique<bool[]>(rows * cols) };
+        uint64_t state{ 0x9e3779b97f4a7c15ULL };
+        for (size_t k = 0; k < rows * cols; ++k)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            ret[k] = state % 3 == 0;
+        }
+
+        return ret;
+    }
+
+    class runner
+    {
+        options options_;
+        std::vector<result> results_;
+    public:
+        explicit runner(options opts) : options_{ std::move(opts) }
+        {
+        }
+
+        [[nodiscard]] auto max_size() const -> size_t { return options_.max_size; }
+
+        // Time body, which returns how many items (samples, bytes) it made,
+        // until min_time has passed. One untimed run warms up first. If
+        // given, metrics is called once, untimed, for figures such as
+        // quality that are reported along with the times.
+        auto run(std::string const &group, std::vector<std::pair<std::string, std::string>> params, std::function<size_t()> const &body,
+                 std::function<std::vector<std::pair<std::string, double>>()> const &metrics = {}) -> void
+        {
+            std::string name{ group };
+            for (auto const &[key, value] : params)
+            {
+                name += fmt::format("/{}:{}", key, value);
+            }
+
+            if (name.find(options_.filter) == std::string::npos)
+            {
+                return;
+            }
+
+            result r{ name, group, std::move(params), {}, body(), metrics ? metrics() : std::vector<std::pair<std::string, double>>{} };
+            double total{ 0.0 };
+            do
+            {
+                auto const start{ std::chrono::steady_clock::now() };
+                r.items = body();
+                double const seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+                r.times.push_back(seconds);
+                total += seconds;
+            } while (total < options_.min_time);
+
+            std::ranges::sort(r.times);
+            std::cerr << fmt::format("{:<72} {:>12.3f} ms x{}\n", r.name, r.times[r.times.size() / 2] * 1e3, r.times.size());
+            results_.push_back(std::move(r));
+        }
+
+        [[nodiscard]] auto json() const -> std::string
+        {
+            std::string ret{ "{\n  \"context\": {\n" };
+            ret += fmt::format("    \"compiler\": \"{}\",\n", compiler());
+#ifdef NDEBUG
+            ret += "    \"build\": \"release\",\n";
+#else
+            ret += "    \"build\": \"debug\",\n";
+#endif
+            ret += fmt::format("    \"threads\": {},\n", std::thread::hardware_concurrency());
+            ret += fmt::format("    \"min_time_s\": {}\n  }},\n  \"benchmarks\": [", options_.min_time);
+            for (size_t k = 0; k < results_.size(); ++k)
+            {
+                result const &r{ results_[k] };
+                double const mean{ std::accumulate(r.times.begin(), r.times.end(), 0.0) / static_cast<double>(r.times.size()) };
+                ret += k == 0 ? "\n" : ",\n";
+                ret += fmt::format("    {{\"name\": \"{}\", \"group\": \"{}\", \"params\": {{", r.name, r.group);
+                for (size_t p = 0; p < r.params.size(); ++p)
+                {
+                    ret += fmt::format("{}\"{}\": \"{}\"", p == 0 ? "" : ", ", r.params[p].first, r.params[p].second);
+                }
+
+                ret += fmt::format("}}, \"repetitions\": {}, \"min_ns\": {:.0f}, \"median_ns\": {:.0f}, \"mean_ns\": {:.0f}, \"items\": {}",
+                    r.times.size(), r.times.front() * 1e9, r.times[r.times.size() / 2] * 1e9, mean * 1e9, r.items);
+                if (!r.metrics.empty())
+                {
+                    ret += ", \"metrics\": {";
+                    for (size_t m = 0; m < r.metrics.size(); ++m)
+                    {
+                        ret += fmt::format("{}\"{}\": {:.6g}", m == 0 ? "" : ", ", r.metrics[m].first, r.metrics[m].second);
+                    }
+
+                    ret += "}";
+                }
+
+                ret += "}";
+            }
+
+            ret += "\n  ]\n}\n";
+            return ret;
+        }
+    private:
+        static auto compiler() -> std::string
+        {
+#if defined(__clang__)
+            return fmt::format("clang {}.{}.{}", __clang_major__, __clang_minor__, __clang_patchlevel__);
+#elif defined(__GNUC__)
+            return fmt::format("gcc {}.{}.{}", __GNUC__, __GNUC_MINOR__, __GNUC_PATCHLEVEL__);
+#elif defined(_MSC_VER)
+            return fmt::format("msvc {}", _MSC_VER);
+#else
+            return "unknown";
+#endif
+        }
+    };
+
+    auto bench_stippling(runner &bench) -> void
+    {
+        for (size_t const size : std::array<size_t, 6>{ 64, 128, 256, 512, 1024, 2048 })
+        {
+            if (size > bench.max_size())
+            {
+                continue;
+            }
+
+            std::vector<float> image{ synthetic_image(size, size) };
+            std::mdspan const view{ image.data(), size, size };
+            for (float const percentage : { 0.1f, 0.33f, 0.5f })
+            {
+                for (float const sigma : { 0.9f, 1.5f })
+                {
+                    bench.run("stippled_image", { { "size", std::to_string(size) }, { "percentage", fmt::format("{}", percentage) }, { "sigma", fmt::format("{}", sigma) } },
+                        [view, percentage, sigma]
+                        {
+                            return brma::stippled_image{ view, percentage, sigma }.samples().size();
+                        });
+                }
+            }
+        }
+    }
+
+    // How far a stipple is from a reference one: the fraction of its dots
+    // that are not dots of the reference, and the RMS difference of the two
+    // after a 7 x 7 box blur, which is near zero when the dots moved but the
+    // tone did not. Dots are set bits; the bench does not negate.
+    auto stipple_difference(brma::bit_mask const &mask, brma::bit_mask const &reference) -> std::vector<std::pair<std::string, double>>
+    {
+        size_t const rows{ mask.rows() };
+        size_t const cols{ mask.cols() };
+        constexpr size_t radius{ 3 };
+        // A summed-area table of mask - reference, one row and column of
+        // zeros first.
+        std::vector<double> sums((rows + 1) * (cols + 1), 0.0);
+        size_t moved{ 0 };
+        size_t dots{ 0 };
+        for (size_t i = 0; i < rows; ++i)
+        {
+            for (size_t j = 0; j < cols; ++j)
+            {
+                bool const dot{ mask[i, j] };
+                bool const reference_dot{ reference[i, j] };
+                dots += dot ? 1 : 0;
+                moved += dot && !reference_dot ? 1 : 0;
+                double const difference{ static_cast<double>(dot) - static_cast<double>(reference_dot) };
+                sums[((i + 1) * (cols + 1)) + j + 1] = difference + sums[(i * (cols + 1)) + j + 1] + sums[((i + 1) * (cols + 1)) + j] - sums[(i * (cols + 1)) + j];
+            }
+        }
+
+        double squares{ 0.0 };
+        for (size_t i = 0; i < rows; ++i)
+        {
+            for (size_t j = 0; j < cols; ++j)
+            {
+                size_t const top{ i > radius ? i - radius : 0 };
+                size_t const left{ j > radius ? j - radius : 0 };
+                size_t const bottom{ std::min(i + radius + 1, rows) };
+                size_t const right{ std::min(j + radius + 1, cols) };
+                double const box{ sums[(bottom * (cols + 1)) + right] - sums[(top * (cols + 1)) + right] - sums[(bottom * (cols + 1)) + left] + sums[(top * (cols + 1)) + left] };
+                double const blurred{ box / static_cast<double>((bottom - top) * (right - left)) };
+                squares += blurred * blurred;
+            }
+        }
+
+        return { { "moved", dots == 0 ? 0.0 : static_cast<double>(moved) / static_cast<double>(dots) },
+                 { "density_rms", std::sqrt(squares / static_cast<double>(rows * cols)) } };
+    }
+
+    // The float stipple is only made if a format is benchmarked.
+    template <typename Energy>
+    auto bench_precision(runner &bench, std::string const &energy, std::mdspan<float, std::dextents<size_t, 2>> view, std::optional<brma::stippled_image> &reference) -> void
+    {
+        bench.run("stippled_image_precision", { { "size", std::to_string(view.extent(0)) }, { "energy", energy } },
+            [view] { return brma::stippled_image{ brma::precision<Energy>{}, view, 0.33f }.samples().size(); },
+            [view, &reference]
+            {
+                if (!reference)
+                {
+                    reference.emplace(view, 0.33f);
+                }
+
+                return stipple_difference(brma::stippled_image{ brma::precision<Energy>{}, view, 0.33f }.mask(), reference->mask());
+            });
+    }
+
+    // The 16-bit energy formats against float, for speed and for how far
+    // their samples land from the float ones.
+    auto bench_precisions(runner &bench) -> void
+    {
+        for (size_t const size : std::array<size_t, 4>{ 256, 512, 1024, 2048 })
+        {
+            if (size > bench.max_size())
+            {
+                continue;
+            }
+
+            std::vector<float> image{ synthetic_image(size, size) };
+            std::mdspan const view{ image.data(), size, size };
+            std::optional<brma::stippled_image> reference;
+            bench_precision<brma::float_energy>(bench, "float", view, reference);
+            bench_precision<brma::bfloat16_energy>(bench, "bfloat16", view, reference);
+            bench_precision<brma::fixed16_energy<>>(bench, "fixed16", view, reference);
+        }
+    }
+
+    auto border_name(brma::border border) -> std::string
+    {
+        return border == brma::border::line ? "line" : "none";
+    }
+
+    template <size_t Size>
+    auto bench_static_braille(runner &bench, bool const *mask, brma::border border) -> void
+    {
+        std::mdspan<bool const, std::extents<size_t, Size, Size>> const view{ mask };
+        bench.run("mask_braille", { { "size", std::to_string(Size) }, { "border", border_name(border) }, { "layout", "static" } },
+            [view, border] { return brma::mask_braille(view, border).size(); });
+    }
+
+    auto bench_braille(runner &bench) -> void
+    {
+        for (size_t const size : std::array<size_t, 4>{ 64, 256, 1024, 4096 })
+        {
+            // Encoding is cheap next to stippling, so masks go up to twice
+            // the largest stippled size.
+            if (size > 2 * bench.max_size())
+            {
+                continue;
+            }
+
+            // Twice as wide, so every other column makes a strided view.
+            auto const pixels{ synthetic_mask(size, 2 * size) };
+            bool const *data{ pixels.get() };
+            std::mdspan const dynamic{ data, size, size };
+            std::layout_stride::mapping const every_other{ std::dextents<size_t, 2>{ size, size }, std::array<size_t, 2>{ 2 * size, 2 } };
+            std::mdspan<bool const, std::dextents<size_t, 2>, std::layout_stride> const strided{ data, every_other };
+            brma::bit_mask const packed{ dynamic };
+            for (brma::border const border : { brma::border::none, brma::border::line })
+            {
+                switch (size)
+                {
+                case 64: bench_static_braille<64>(bench, data, border); break;
+                case 256: bench_static_braille<256>(bench, data, border); break;
+                case 1024: bench_static_braille<1024>(bench, data, border); break;
+                default: break;
+                }
+
+                bench.run("mask_braille", { { "size", std::to_string(size) }, { "border", border_name(border) }, { "layout", "dynamic" } },
+                    [dynamic, border] { return brma::mask_braille(dynamic, border).size(); });
+                bench.run("mask_braille", { { "size", std::to_string(size) }, { "border", border_name(border) }, { "layout", "strided" } },
+                    [strided, border] { return brma::mask_braille(strided, border).size(); });
+                bench.run("mask_braille", { { "size", std::to_string(size) }, { "border", border_name(border) }, { "layout", "bit_mask" } },
+                    [&packed, border] { return brma::mask_braille(packed, border).size(); });
+                bench.run("mask_braille", { { "size", std::to_string(size) }, { "border", border_name(border) }, { "layout", "bit_mask_parallel" } },
+                    [&packed, border] { return brma::mask_braille(std::execution::par, packed, border).size(); });
+            }
+        }
+    }
+
+    auto parse(int argc, char **argv) -> options
+    {
+        options ret;
+        for (int k = 1; k + 1 < argc; k += 2)
+        {
+            std::string_view const flag{ argv[k] };
+            char const *value{ argv[k + 1] };
+            if (flag == "--out")
+            {
+                ret.out = value;
+            }
+            else if (flag == "--filter")
+            {
+                ret.filter = value;
+            }
+            else if (flag == "--max-size")
+            {
+                ret.max_size = std::stoul(value);
+            }
+            else if (flag == "--min-time")
+            {
+                ret.min_time = std::stod(value);
+            }
+            else
+            {
+                std::cerr << "unknown option " << flag << "\n";
+            }
+        }
+
+        return ret;
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    options const opts{ parse(argc, argv) };
+    runner bench{ opts };
+    bench_braille(bench);
+    bench_stippling(bench);
+    bench_precisions(bench);
+
+    std::string const json{ bench.json() };
+    if (opts.out.empty())
+    {
+        std::cout << json;
+        return 0;
+    }
+
+    std::ofstream file{ opts.out, std::ios::binary };
+    if (!(file << json))
+    {
+        std::cerr << "cannot write " << opts.out << "\n";
+        return 1;
+    }
+
+    return 0;
+}
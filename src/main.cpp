@@ -3,11 +3,13 @@
 #define cimg_use_lapack
 // ReSharper restore CppInconsistentNaming
 #include <CImg.h>
+#include <array>
 #include <iostream>
 #include <vector>
 #include <mdspan>
 #include <string>
 #include <braille_based_image.h>
+#include <image_ingest.h>
 #include <stippled_image.h>
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN  // NOLINT(clang-diagnostic-unused-macros)
@@ -42,37 +44,35 @@ namespace
 
     auto image() -> void
     {
-        constexpr int image_size {256};
+        constexpr size_t image_size {256};
 
-        // Load and convert to grayscale
-        cimg_library::CImg<float> image("obama.png");
+        // Load as 8 bit pixels
+        cimg_library::CImg<unsigned char> const image("obama.png");
         if (image.is_empty())
         {
             std::cerr << "Failed to load image.\n";
             return;
         }
-        if (image.spectrum() == 3)
-        {
-            image = image.get_RGBtoYCbCr().get_channel(0); // Convert to grayscale
-        }
-        image.resize(image_size, image_size); // Resize with default cubic interpolation
-        image.blur(0.5f);  // sharpening makes the stippled image better
 
-        // Normalize to [0, 1]
-        float const image_min = image.min();
-        float const image_max = image.max();
-        image = (image - image_min) / (image_max - image_min);
+        // CImg keeps each channel in its own plane
+        auto const width = static_cast<size_t>(image.width());
+        auto const height = static_cast<size_t>(image.height());
+        std::layout_stride::mapping const planar(
+            std::dextents<size_t, 3>(height, width, static_cast<size_t>(image.spectrum())),
+            std::array<size_t, 3>{ width, 1, width * height * static_cast<size_t>(image.depth()) });
+        std::mdspan<unsigned char const, std::dextents<size_t, 3>, std::layout_stride> const pixels(image.data(), planar);
 
-        // Flatten into std::vector<float>
-        std::vector<float> image_data(image.size());
-        std::ranges::copy(image, image_data.begin());
+        // Grayscale, resize and normalize to [0, 1] in one pass
+        brma::image_ingest ingest(image_size, image_size);
+        auto const image_mdspan = ingest.ingest(pixels);
 
-        // Wrap in mdspan
-        std::mdspan<float, std::extents<size_t, image_size, image_size>> const image_mdspan(image_data.data());
+        // Blur in place and renormalize, sharpening makes the stippled image better
+        cimg_library::CImg<float> shared(image_mdspan.data_handle(), image_size, image_size, 1, 1, true);
+        shared.blur(0.5f).normalize(0.0f, 1.0f);
 
         // Example access
         brma::stippled_image const stippled_image(image_mdspan, .5);
-        std::cout << brma::mask_braille(stippled_image.stippled(), brma::border::line) << "\n";
+        std::cout << brma::mask_braille(stippled_image.mask(), brma::border::line) << "\n";
     }
 }
 
@@ -0,0 +1,149 @@
+// Checks of the dither renderer: the ordered matrix is a Bayer matrix, and
+// the wavefront diffusion gives the same dots as a plain serial scan.
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <dither_renderer.h>
+#include <mdspan>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    int failures{ 0 };
+
+    auto check(bool ok, std::string_view what) -> void
+    {
+        if (!ok)
+        {
+            ++failures;
+            std::printf("FAIL %.*s\n", static_cast<int>(what.size()), what.data());
+        }
+    }
+
+    auto ranks() -> std::array<uint32_t, 64>
+    {
+        std::array<uint32_t, 64> ret{};
+        for (size_t k = 0; k < 64; ++k)
+        {
+            ret[k] = static_cast<uint32_t>(brma::detail::bayer_8x8[k] * 64.0f);
+        }
+
+        return ret;
+    }
+
+    auto check_bayer() -> void
+    {
+        std::array<uint32_t, 64> const rank{ ranks() };
+        std::array<bool, 64> seen{};
+        for (uint32_t const r : rank)
+        {
+            check(r < 64 && !seen[r], "bayer ranks are a permutation of 0..63");
+            seen[r % 64] = true;
+        }
+
+        constexpr std::array<uint32_t, 8> first_row{ 0, 32, 8, 40, 2, 34, 10, 42 };
+        for (size_t j = 0; j < 8; ++j)
+        {
+            check(rank[j] == first_row[j], "bayer first row");
+        }
+
+        // The 4, 16 and 64 lowest ranks each fill a lattice of spacing 4, 2
+        // and 1: one per 4x4, 2x2 and 1x1 block.
+        for (uint32_t spacing = 4; spacing >= 1; spacing /= 2)
+        {
+            uint32_t const count{ 64 / (spacing * spacing) };
+            for (uint32_t i = 0; i < 8; ++i)
+            {
+                for (uint32_t j = 0; j < 8; ++j)
+                {
+                    bool const on_lattice{ i % spacing == 0 && j % spacing == 0 };
+                    check((rank[(i * 8) + j] < count) == on_lattice, "bayer lowest ranks spread out");
+                }
+            }
+        }
+    }
+
+    // The serial error diffusion the renderer parallelizes.
+    auto serial_diffusion(std::vector<float> work, size_t rows, size_t cols, brma::dither method) -> brma::bit_mask
+    {
+        brma::bit_mask ret{ rows, cols };
+        for (size_t i = 0; i < rows; ++i)
+        {
+            for (size_t j = 0; j < cols; ++j)
+            {
+                float const value{ work[(i * cols) + j] };
+                bool const ink{ value < 0.5f };
+                float const error{ ink ? value : value - 1.0f };
+                ret.set(i, j, ink);
+                auto const push = [&work, rows, cols](size_t r, size_t c, float amount)
+                    {
+                        if (r < rows && c < cols)
+                        {
+                            work[(r * cols) + c] += amount;
+                        }
+                    };
+
+                if (method == brma::dither::floyd_steinberg)
+                {
+                    push(i, j + 1, error * (7.0f / 16.0f));
+                    push(i + 1, j - 1, error * (3.0f / 16.0f));
+                    push(i + 1, j, error * (5.0f / 16.0f));
+                    push(i + 1, j + 1, error * (1.0f / 16.0f));
+                }
+                else
+                {
+                    float const eighth{ error * 0.125f };
+                    push(i, j + 1, eighth);
+                    push(i, j + 2, eighth);
+                    push(i + 1, j - 1, eighth);
+                    push(i + 1, j, eighth);
+                    push(i + 1, j + 1, eighth);
+                    push(i + 2, j, eighth);
+                }
+            }
+        }
+
+        return ret;
+    }
+
+    auto check_diffusion(brma::dither method, std::string_view what) -> void
+    {
+        // Large enough for the wavefront, with a partial last block.
+        constexpr size_t rows{ 700 };
+        constexpr size_t cols{ 600 };
+        static_assert(rows * cols >= brma::dither_renderer::wavefront_pixels && cols > 2 * brma::dither_renderer::block_cols);
+        std::vector<float> image(rows * cols);
+        uint32_t state{ 7 };
+        for (size_t i = 0; i < rows; ++i)
+        {
+            for (size_t j = 0; j < cols; ++j)
+            {
+                state = (state * 1664525u) + 1013904223u;
+                float const noise{ static_cast<float>(state >> 8) / 16777216.0f };
+                image[(i * cols) + j] = (0.8f * static_cast<float>(i + j) / static_cast<float>(rows + cols)) + (0.2f * noise);
+            }
+        }
+
+        brma::dither_renderer renderer{ method };
+        brma::bit_mask const &rendered{ renderer.render(std::mdspan{ image.data(), rows, cols }) };
+        brma::bit_mask const expected{ serial_diffusion(image, rows, cols, method) };
+        bool same{ true };
+        for (size_t i = 0; i < rows; ++i)
+        {
+            same = same && std::ranges::equal(rendered.row(i), expected.row(i));
+        }
+
+        check(same, what);
+    }
+}
+
+int main()
+{
+    check_bayer();
+    check_diffusion(brma::dither::floyd_steinberg, "floyd_steinberg wavefront matches the serial scan");
+    check_diffusion(brma::dither::atkinson, "atkinson wavefront matches the serial scan");
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+// Checks of pixel ingestion: same-size ingest is exact, resampling keeps
+// flat images flat, and the band split does not change the output.
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <image_ingest.h>
+#include <mdspan>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    int failures{ 0 };
+
+    auto check(bool ok, std::string_view what, size_t rows, size_t cols) -> void
+    {
+        if (!ok)
+        {
+            ++failures;
+            std::printf("FAIL %.*s %zux%zu\n", static_cast<int>(what.size()), what.data(), rows, cols);
+        }
+    }
+
+    // A gray ramp through every 16 bit level, ingested at its own size and
+    // not normalized, comes back as the levels over 65535.
+    auto check_identity(size_t rows, size_t cols) -> void
+    {
+        std::vector<uint16_t> pixels(rows * cols);
+        for (size_t k = 0; k < pixels.size(); ++k)
+        {
+            pixels[k] = static_cast<uint16_t>((k * 65535) / (pixels.size() - 1));
+        }
+
+        brma::image_ingest ingest{ 0, 0, false };
+        auto const image{ ingest.ingest(std::mdspan{ pixels.data(), rows, cols }) };
+        bool same{ image.extent(0) == rows && image.extent(1) == cols };
+        for (size_t i = 0; same && i < rows; ++i)
+        {
+            for (size_t j = 0; same && j < cols; ++j)
+            {
+                same = image[i, j] == static_cast<float>(pixels[(i * cols) + j]) * (1.0f / 65535.0f);
+            }
+        }
+
+        check(same, "identity ingest reproduces the ramp", rows, cols);
+    }
+
+    // A flat RGB image stays flat at any output size, normalized or not.
+    auto check_constant(size_t rows, size_t cols, size_t out_rows, size_t out_cols) -> void
+    {
+        std::vector<uint8_t> pixels(rows * cols * 3);
+        for (size_t k = 0; k < pixels.size(); k += 3)
+        {
+            pixels[k] = 200;
+            pixels[k + 1] = 100;
+            pixels[k + 2] = 50;
+        }
+
+        std::mdspan const view{ pixels.data(), rows, cols, size_t{ 3 } };
+        float const luma{ ((0.299f * 200.0f) + (0.587f * 100.0f) + (0.114f * 50.0f)) / 255.0f };
+        for (bool const normalize : { false, true })
+        {
+            brma::image_ingest ingest{ out_rows, out_cols, normalize };
+            auto const image{ ingest.ingest(view) };
+            bool flat{ image.extent(0) == out_rows && image.extent(1) == out_cols };
+            for (size_t i = 0; flat && i < out_rows; ++i)
+            {
+                for (size_t j = 0; flat && j < out_cols; ++j)
+                {
+                    flat = std::abs(image[i, j] - luma) <= 1e-5f;
+                }
+            }
+
+            check(flat, normalize ? "constant image stays constant, normalized" : "constant image stays constant", out_rows, out_cols);
+        }
+    }
+
+    // However many bands the rows are split into, the output is the same
+    // bit for bit.
+    auto check_bands(size_t rows, size_t cols, size_t out_rows, size_t out_cols) -> void
+    {
+        std::vector<uint8_t> pixels(rows * cols);
+        uint32_t state{ 11 };
+        for (uint8_t &p : pixels)
+        {
+            state = (state * 1664525u) + 1013904223u;
+            p = static_cast<uint8_t>(state >> 24);
+        }
+
+        std::mdspan const view{ pixels.data(), rows, cols };
+        brma::image_ingest serial{ out_rows, out_cols, true, 1 };
+        std::vector<float> expected;
+        auto const reference{ serial.ingest(view) };
+        expected.assign(reference.data_handle(), reference.data_handle() + (reference.extent(0) * reference.extent(1)));
+        for (size_t const bands : std::array<size_t, 5>{ 2, 3, 7, 64, 0 })
+        {
+            brma::image_ingest banded{ out_rows, out_cols, true, bands };
+            auto const image{ banded.ingest(view) };
+            bool same{ image.extent(0) * image.extent(1) == expected.size() };
+            for (size_t k = 0; same && k < expected.size(); ++k)
+            {
+                same = std::bit_cast<uint32_t>(image.data_handle()[k]) == std::bit_cast<uint32_t>(expected[k]);
+            }
+
+            check(same, "band count does not change the output", out_rows, out_cols);
+        }
+    }
+}
+
+int main()
+{
+    check_identity(1, 1000);
+    check_identity(97, 131);
+    check_constant(97, 131, 40, 50);
+    check_constant(97, 131, 200, 300);
+    check_constant(300, 200, 33, 7);
+    // Shrinking, growing and the same size, with each output row fed by a
+    // few source rows so the accumulator ring wraps many times.
+    check_bands(517, 203, 130, 60);
+    check_bands(97, 131, 400, 500);
+    check_bands(256, 256, 256, 256);
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+// Checks that every way of encoding a mask as braille text gives the same
+// bytes: row-major, strided and bit-packed masks, serially, on all cores
+// and streamed to each sink.
+#include <array>
+#include <braille_based_image.h>
+#include <cstdint>
+#include <cstdio>
+#include <execution>
+#include <iterator>
+#include <mdspan>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace
+{
+    int failures{ 0 };
+
+    auto check(bool ok, std::string_view what, size_t rows, size_t cols, brma::border border) -> void
+    {
+        if (!ok)
+        {
+            ++failures;
+            std::printf("FAIL %.*s %zux%zu%s\n", static_cast<int>(what.size()), what.data(), rows, cols, border == brma::border::line ? " border" : "");
+        }
+    }
+
+    // A mask with about a third of its pixels set, and the same pixels
+    // stored column-major for a strided view.
+    struct test_mask
+    {
+        size_t rows;
+        size_t cols;
+        std::unique_ptr<bool[]> row_major;
+        std::unique_ptr<bool[]> col_major;
+
+        test_mask(size_t r, size_t c, uint32_t seed)
+            : rows{ r }, cols{ c }, row_major{ std::make_unique<bool[]>(r * c) }, col_major{ std::make_unique<bool[]>(r * c) }
+        {
+            uint32_t state{ seed };
+            for (size_t i = 0; i < rows; ++i)
+            {
+                for (size_t j = 0; j < cols; ++j)
+                {
+                    state = (state * 1664525u) + 1013904223u;
+                    bool const set{ (state >> 24) < 85 };
+                    row_major[(i * cols) + j] = set;
+                    col_major[(j * rows) + i] = set;
+                }
+            }
+        }
+
+        [[nodiscard]] auto contiguous() const
+        {
+            return std::mdspan<bool const, std::dextents<size_t, 2>>{ row_major.get(), rows, cols };
+        }
+
+        [[nodiscard]] auto strided() const
+        {
+            std::layout_stride::mapping const mapping{ std::dextents<size_t, 2>{ rows, cols }, std::array<size_t, 2>{ 1, rows } };
+            return std::mdspan<bool const, std::dextents<size_t, 2>, std::layout_stride>{ col_major.get(), mapping };
+        }
+    };
+
+    // The text mask_braille_to writes through each of its sinks.
+    template <typename Mask>
+    auto iterator_text(Mask const &mask, brma::border border) -> std::string
+    {
+        std::string ret;
+        brma::mask_braille_to(std::back_inserter(ret), mask, border);
+        return ret;
+    }
+
+    template <typename Mask>
+    auto stream_text(Mask const &mask, brma::border border) -> std::string
+    {
+        std::ostringstream stream;
+        brma::mask_braille_to(stream, mask, border);
+        return std::move(stream).str();
+    }
+
+#if BRMA_POSIX_FD
+    // Written to a temporary file and read back.
+    template <typename Mask>
+    auto fd_text(Mask const &mask, brma::border border) -> std::string
+    {
+        std::unique_ptr<std::FILE, int (*)(std::FILE *)> const file{ std::tmpfile(), &std::fclose };
+        if (!file)
+        {
+            return "no temporary file";
+        }
+
+        brma::mask_braille_to(fileno(file.get()), mask, border);
+        std::string ret;
+        std::rewind(file.get());
+        std::array<char, 4096> buffer{};
+        for (size_t read = 0; (read = std::fread(buffer.data(), 1, buffer.size(), file.get())) != 0;)
+        {
+            ret.append(buffer.data(), read);
+        }
+
+        return ret;
+    }
+#endif
+
+    // The 6x5 mask of check_text, with static extents.
+    constexpr std::array<bool, 30> icon_pixels{ [] {
+        std::array<bool, 30> ret{};
+        for (size_t k = 0; k < ret.size(); ++k)
+        {
+            ret[k] = (k * 7) % 3 == 0 || k % 11 == 0;
+        }
+
+        return ret;
+    }() };
+
+    constexpr std::mdspan<bool const, std::extents<size_t, 6, 5>> icon{ icon_pixels.data() };
+
+    // mask_braille_array evaluated at compile time.
+    constexpr auto icon_text{ brma::mask_braille_array(icon) };
+    constexpr auto framed_icon_text{ brma::mask_braille_array<brma::border::line>(icon) };
+    static_assert(std::string_view{ icon_text.data(), icon_text.size() } == "⢢⡐⠄\n⠑⠎⠂");
+    static_assert(std::string_view{ framed_icon_text.data(), framed_icon_text.size() } == "╭───╮\n│⢢⡐⠄│\n│⠑⠎⠂│\n╰───╯");
+
+    // The runtime branch, and mask_braille, give the same text.
+    auto check_array() -> void
+    {
+        auto const text{ brma::mask_braille_array(icon) };
+        auto const framed{ brma::mask_braille_array<brma::border::line>(icon) };
+        check(std::string_view{ text.data(), text.size() } == brma::mask_braille(icon), "runtime mask_braille_array", 6, 5, brma::border::none);
+        check(std::string_view{ framed.data(), framed.size() } == brma::mask_braille(icon, brma::border::line), "runtime mask_braille_array", 6, 5, brma::border::line);
+    }
+
+    auto check_encodings(size_t rows, size_t cols, uint32_t seed) -> void
+    {
+        test_mask const mask{ rows, cols, seed };
+        brma::bit_mask const packed{ mask.contiguous() };
+        for (brma::border const border : { brma::border::none, brma::border::line })
+        {
+            std::string const expected{ brma::mask_braille(mask.contiguous(), border) };
+            check(brma::mask_braille(mask.strided(), border) == expected, "strided", rows, cols, border);
+            check(brma::mask_braille(packed, border) == expected, "bit_mask", rows, cols, border);
+            check(brma::mask_braille(std::execution::par, mask.contiguous(), border) == expected, "parallel contiguous", rows, cols, border);
+            check(brma::mask_braille(std::execution::par, mask.strided(), border) == expected, "parallel strided", rows, cols, border);
+            check(brma::mask_braille(std::execution::par, packed, border) == expected, "parallel bit_mask", rows, cols, border);
+            check(iterator_text(mask.contiguous(), border) == expected, "iterator sink", rows, cols, border);
+            check(iterator_text(packed, border) == expected, "iterator sink bit_mask", rows, cols, border);
+            check(stream_text(mask.strided(), border) == expected, "ostream sink strided", rows, cols, border);
+            check(stream_text(packed, border) == expected, "ostream sink bit_mask", rows, cols, border);
+#if BRMA_POSIX_FD
+            check(fd_text(mask.contiguous(), border) == expected, "fd sink", rows, cols, border);
+#endif
+        }
+    }
+
+    // Pin the text itself, so the encoders cannot all drift together. The
+    // 8x6 mask needs no padding; the 6x5 one is padded a row above and
+    // below, and a column on the right.
+    auto check_text(size_t rows, size_t cols, std::string_view plain, std::string_view framed) -> void
+    {
+        std::unique_ptr<bool[]> const pixels{ std::make_unique<bool[]>(rows * cols) };
+        for (size_t k = 0; k < rows * cols; ++k)
+        {
+            pixels[k] = (k * 7) % 3 == 0 || k % 11 == 0;
+        }
+
+        std::mdspan<bool const, std::dextents<size_t, 2>> const mask{ pixels.get(), rows, cols };
+        check(brma::mask_braille(mask) == plain, "known text", rows, cols, brma::border::none);
+        check(brma::mask_braille(mask, brma::border::line) == framed, "known text", rows, cols, brma::border::line);
+    }
+}
+
+int main()
+{
+    check_text(8, 6, "⡇⢸⡐\n⡇⣸⠀", "╭───╮\n│⡇⢸⡐│\n│⡇⣸⠀│\n╰───╯");
+    check_array();
+    check_text(6, 5, "⢢⡐⠄\n⠑⠎⠂", "╭───╮\n│⢢⡐⠄│\n│⠑⠎⠂│\n╰───╯");
+
+    // Every padding case, around the 64-pixel words of a bit_mask.
+    for (size_t rows = 1; rows <= 130; ++rows)
+    {
+        for (size_t cols = 1; cols <= 200; cols += cols < 10 || (cols > 60 && cols < 70) || cols > 124 ? 1 : 7)
+        {
+            check_encodings(rows, cols, static_cast<uint32_t>((rows * 1000) + cols));
+        }
+    }
+
+    // Large enough for the parallel encoder to split into bands.
+    check_encodings(1027, 1999, 1);
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
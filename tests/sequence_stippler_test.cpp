@@ -0,0 +1,181 @@
+// Checks of the sequence stippler: its first frame is the stippler's, and
+// later frames keep the sample count with one sample per pixel.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <mdspan>
+#include <numeric>
+#include <sequence_stippler.h>
+#include <stippled_image.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    int failures{ 0 };
+
+    auto check(bool ok, std::string_view what, std::string const &where) -> void
+    {
+        if (!ok)
+        {
+            ++failures;
+            std::printf("FAIL %.*s (%s)\n", static_cast<int>(what.size()), what.data(), where.c_str());
+        }
+    }
+
+    auto same_samples(brma::sample_spans a, brma::sample_spans b) -> bool
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+
+        for (size_t k = 0; k < a.size(); ++k)
+        {
+            if (a.rows[k] != b.rows[k] || a.cols[k] != b.cols[k] || a.values[k] != b.values[k])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    auto same_mask(brma::bit_mask const &a, brma::bit_mask const &b) -> bool
+    {
+        if (a.rows() != b.rows() || a.cols() != b.cols())
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < a.rows(); ++i)
+        {
+            if (!std::ranges::equal(a.row(i), b.row(i)))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // The stippler lists samples in placement order, the sequence stippler
+    // row-major. Sort a copy of the stippler's to compare them.
+    struct row_major_samples
+    {
+        std::vector<uint32_t> rows;
+        std::vector<uint32_t> cols;
+        std::vector<float> values;
+
+        explicit row_major_samples(brma::sample_spans samples)
+        {
+            std::vector<size_t> order(samples.size());
+            std::iota(order.begin(), order.end(), size_t{ 0 });
+            std::ranges::sort(order, {}, [&samples](size_t k) { return std::pair{ samples.rows[k], samples.cols[k] }; });
+            for (size_t k : order)
+            {
+                rows.push_back(samples.rows[k]);
+                cols.push_back(samples.cols[k]);
+                values.push_back(samples.values[k]);
+            }
+        }
+
+        [[nodiscard]] auto spans() const -> brma::sample_spans { return { rows, cols, values }; }
+    };
+
+    // Row-major order with no pixel twice, and every sample set in the mask.
+    auto unique_samples(brma::sequence_stippler const &stipple, bool negate) -> bool
+    {
+        brma::sample_spans const samples{ stipple.samples() };
+        for (size_t k = 0; k < samples.size(); ++k)
+        {
+            uint64_t const at{ (uint64_t{ samples.rows[k] } << 32U) | samples.cols[k] };
+            if (k > 0 && at <= ((uint64_t{ samples.rows[k - 1] } << 32U) | samples.cols[k - 1]))
+            {
+                return false;
+            }
+
+            if (stipple.mask()[samples.rows[k], samples.cols[k]] == negate)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // A diagonal ramp with a bright disc centred at (x, y).
+    auto frame(size_t rows, size_t cols, float x, float y) -> std::vector<float>
+    {
+        std::vector<float> image(rows * cols);
+        for (size_t i = 0; i < rows; ++i)
+        {
+            for (size_t j = 0; j < cols; ++j)
+            {
+                float const ramp{ static_cast<float>(i + j) / static_cast<float>(rows + cols) };
+                float const di{ static_cast<float>(i) - x };
+                float const dj{ static_cast<float>(j) - y };
+                image[(i * cols) + j] = (di * di) + (dj * dj) < 100.0f ? 1.0f : ramp;
+            }
+        }
+
+        return image;
+    }
+
+    auto check_sequence(size_t rows, size_t cols, float percentage, bool negate, float window_sigmas) -> void
+    {
+        std::string const where{ std::to_string(rows) + "x" + std::to_string(cols) + " p=" + std::to_string(percentage) + (negate ? " negate" : "") + " window=" + std::to_string(window_sigmas) };
+        std::vector<float> still{ frame(rows, cols, 20.0f, 20.0f) };
+        std::mdspan const view{ still.data(), rows, cols };
+
+        brma::sequence_stippler stipple{ percentage, 0.9f, 0.5f, negate, window_sigmas };
+        stipple.next(view);
+        brma::stippled_image const expected{ view, percentage, 0.9f, 0.5f, negate, window_sigmas };
+        row_major_samples const first{ expected.samples() };
+        check(same_samples(stipple.samples(), first.spans()), "first frame is the stippler's", where);
+        check(same_mask(stipple.mask(), expected.mask()), "first frame mask is the stippler's", where);
+        check(unique_samples(stipple, negate), "first frame samples unique", where);
+
+        for (int f = 0; f < 4; ++f)
+        {
+            stipple.next(view);
+            check(stipple.moved() == 0, "a still frame moves nothing", where);
+            check(same_samples(stipple.samples(), first.spans()), "a still frame keeps its samples", where);
+        }
+
+        // Move the disc across the frame, then hold it still.
+        size_t const count{ first.rows.size() };
+        size_t moved{ 0 };
+        for (int f = 1; f <= 8; ++f)
+        {
+            float const step{ static_cast<float>(std::min(f, 5)) };
+            std::vector<float> moving{ frame(rows, cols, 20.0f + (4.0f * step), 20.0f + (6.0f * step)) };
+            stipple.next(std::mdspan{ moving.data(), rows, cols });
+            moved += stipple.moved();
+            check(stipple.samples().size() == count, "moving frames keep the sample count", where);
+            check(unique_samples(stipple, negate), "moving frame samples unique", where);
+        }
+
+        check(window_sigmas == 0.0f || moved > 0, "moving frames relax the samples", where);
+    }
+}
+
+int main()
+{
+    for (bool const negate : { false, true })
+    {
+        for (float const percentage : { 0.1f, 0.33f })
+        {
+            check_sequence(96, 128, percentage, negate, 4.0f);
+            check_sequence(61, 77, percentage, negate, 4.0f);
+            // Too small a window for local updates: every frame restarts.
+            check_sequence(61, 77, percentage, negate, 0.0f);
+        }
+    }
+
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+// Checks every SIMD kernel the CPU can run against the scalar one, bit for
+// bit, over lengths around each vector width and data full of ties.
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <simd_kernels.h>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    namespace simd = brma::detail::simd;
+
+    int failures{ 0 };
+
+    auto check(bool ok, std::string_view isa, std::string_view kernel, size_t n) -> void
+    {
+        if (!ok)
+        {
+            ++failures;
+            std::printf("FAIL %.*s %.*s n=%zu\n", static_cast<int>(isa.size()), isa.data(), static_cast<int>(kernel.size()), kernel.data(), n);
+        }
+    }
+
+    auto same_bits(std::vector<float> const &a, std::vector<float> const &b) -> bool
+    {
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (std::bit_cast<uint32_t>(a[i]) != std::bit_cast<uint32_t>(b[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Few distinct values, so minima tie often, plus some infinities.
+    auto tied_values(size_t n, uint32_t seed) -> std::vector<float>
+    {
+        std::vector<float> ret(n);
+        uint32_t state{ seed };
+        for (float &v : ret)
+        {
+            state = (state * 1664525u) + 1013904223u;
+            uint32_t const pick{ state >> 24 };
+            v = pick < 16 ? std::numeric_limits<float>::infinity() : (static_cast<float>(pick % 7) * 0.1f) - 0.3f;
+        }
+
+        return ret;
+    }
+
+    // Values whose products and sums round, to catch fused or reordered
+    // arithmetic.
+    auto rounding_values(size_t n, uint32_t seed) -> std::vector<float>
+    {
+        std::vector<float> ret(n);
+        uint32_t state{ seed };
+        for (float &v : ret)
+        {
+            state = (state * 1664525u) + 1013904223u;
+            v = (static_cast<float>(state >> 8) / 16777216.0f) - 0.5f;
+        }
+
+        return ret;
+    }
+
+    auto check_isa(simd::isa set, std::string_view name) -> void
+    {
+        simd::kernels const reference{ simd::kernels_for(simd::isa::scalar) };
+        simd::kernels const tested{ simd::kernels_for(set) };
+        std::vector<size_t> lengths;
+        for (size_t n = 0; n <= 70; ++n)
+        {
+            lengths.push_back(n);
+        }
+
+        for (size_t const n : std::array<size_t, 4>{ 255, 256, 1000, 4099 })
+        {
+            lengths.push_back(n);
+        }
+
+        for (size_t const n : lengths)
+        {
+            for (uint32_t const seed : std::array<uint32_t, 3>{ 1, 2, 3 })
+            {
+                std::vector<float> const tied{ tied_values(n, seed) };
+                std::vector<float> const noisy{ rounding_values(n, seed) };
+                std::vector<float> const src{ rounding_values(n, seed + 100) };
+
+                check(reference.min_element(tied.data(), n) == tested.min_element(tied.data(), n), name, "min_element", n);
+                check(reference.min_element(noisy.data(), n) == tested.min_element(noisy.data(), n), name, "min_element", n);
+
+                std::vector<float> expected{ noisy };
+                std::vector<float> actual{ noisy };
+                reference.add(expected.data(), src.data(), n);
+                tested.add(actual.data(), src.data(), n);
+                check(same_bits(expected, actual), name, "add", n);
+
+                // Adding zero keeps the ties.
+                std::vector<float> const zeros(n, 0.0f);
+                expected = tied;
+                actual = tied;
+                size_t const expected_min{ reference.add_min(expected.data(), zeros.data(), n) };
+                size_t const actual_min{ tested.add_min(actual.data(), zeros.data(), n) };
+                check(expected_min == actual_min && same_bits(expected, actual), name, "add_min", n);
+
+                expected = noisy;
+                actual = noisy;
+                check(reference.add_min(expected.data(), src.data(), n) == tested.add_min(actual.data(), src.data(), n) && same_bits(expected, actual), name, "add_min", n);
+
+                reference.scale(expected.data(), noisy.data(), 0.3f, -1.0f, n);
+                tested.scale(actual.data(), noisy.data(), 0.3f, -1.0f, n);
+                check(same_bits(expected, actual), name, "scale", n);
+
+                expected = noisy;
+                actual = noisy;
+                reference.add_scaled(expected.data(), src.data(), 0.7f, n);
+                tested.add_scaled(actual.data(), src.data(), 0.7f, n);
+                check(same_bits(expected, actual), name, "add_scaled", n);
+            }
+        }
+    }
+}
+
+int main()
+{
+    // Instruction sets are supersets of the ones before them.
+    simd::isa const detected{ simd::detect() };
+    constexpr std::array<std::pair<simd::isa, std::string_view>, 4> sets{ {
+        { simd::isa::scalar, "scalar" }, { simd::isa::sse4_2, "sse4_2" }, { simd::isa::avx2, "avx2" }, { simd::isa::avx512, "avx512" } } };
+    for (auto const &[set, name] : sets)
+    {
+        if (set <= detected)
+        {
+            check_isa(set, name);
+            std::printf("%.*s checked\n", static_cast<int>(name.size()), name.data());
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+// Checks of the on-disk stipple cache: a stored stipple reads back the same,
+// and damaged files are misses that the next stipple() replaces.
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mdspan>
+#include <optional>
+#include <random>
+#include <stipple_cache.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    int failures{ 0 };
+
+    auto check(bool ok, std::string_view what) -> void
+    {
+        if (!ok)
+        {
+            ++failures;
+            std::printf("FAIL %.*s\n", static_cast<int>(what.size()), what.data());
+        }
+    }
+
+    auto same_stipple(brma::cached_stipple const &cached, brma::stippled_image const &stipple) -> bool
+    {
+        brma::sample_spans const a{ cached.samples() };
+        brma::sample_spans const b{ stipple.samples() };
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+
+        for (size_t k = 0; k < a.size(); ++k)
+        {
+            if (a.rows[k] != b.rows[k] || a.cols[k] != b.cols[k] || a.values[k] != b.values[k])
+            {
+                return false;
+            }
+        }
+
+        brma::bit_mask const mask{ cached.mask() };
+        for (size_t i = 0; i < mask.rows(); ++i)
+        {
+            if (!std::ranges::equal(mask.row(i), stipple.mask().row(i)))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Overwrite bytes of a file in place.
+    auto patch(std::filesystem::path const &path, uintmax_t offset, void const *bytes, size_t size) -> void
+    {
+        std::fstream file{ path, std::ios::in | std::ios::out | std::ios::binary };
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.write(static_cast<char const *>(bytes), static_cast<std::streamsize>(size));
+    }
+}
+
+int main()
+{
+    namespace fs = std::filesystem;
+    fs::path const directory{ fs::temp_directory_path() / ("brma_stipple_cache_test_" + std::to_string(std::random_device{}())) };
+
+    {
+        // 100 columns, so each mask row ends in padding bits.
+        constexpr size_t rows{ 90 };
+        constexpr size_t cols{ 100 };
+        std::vector<float> image(rows * cols);
+        for (size_t k = 0; k < image.size(); ++k)
+        {
+            image[k] = static_cast<float>(k % 97) / 97.0f;
+        }
+
+        std::mdspan const view{ image.data(), rows, cols };
+        brma::stipple_cache const cache{ directory };
+        brma::stippled_image const expected{ view, 0.3f };
+        brma::stipple_key const key{ brma::stipple_key::of(view, 0.3f) };
+        fs::path const path{ cache.path_of(key) };
+
+        check(!cache.find(key), "empty cache misses");
+        check(same_stipple(cache.stipple(view, 0.3f), expected), "stored stipple");
+        std::optional<brma::cached_stipple> const hit{ cache.find(key) };
+        check(hit && same_stipple(*hit, expected), "round trip");
+        check(!cache.find(brma::stipple_key::of(view, 0.31f)), "other parameters miss");
+
+        // The samples are the last arrays: rows, cols, then values, after
+        // the mask words.
+        size_t const count{ expected.samples().size() };
+        uintmax_t const samples_offset{ fs::file_size(path) - (count * ((2 * sizeof(uint32_t)) + sizeof(float))) };
+        uintmax_t const mask_offset{ samples_offset - (rows * ((cols + 63) / 64) * sizeof(uint64_t)) };
+
+        fs::resize_file(path, fs::file_size(path) - 4);
+        check(!cache.find(key), "truncated file misses");
+        check(same_stipple(cache.stipple(view, 0.3f), expected), "truncated file replaced");
+        check(cache.find(key).has_value(), "replaced file hits");
+
+        auto const off_image{ static_cast<uint32_t>(rows) };
+        patch(path, samples_offset, &off_image, sizeof(off_image));
+        check(!cache.find(key), "sample row off the image misses");
+        fs::remove(path);
+        (void)cache.stipple(view, 0.3f);
+
+        auto const off_image_col{ static_cast<uint32_t>(cols) };
+        patch(path, samples_offset + (count * sizeof(uint32_t)), &off_image_col, sizeof(off_image_col));
+        check(!cache.find(key), "sample column off the image misses");
+        fs::remove(path);
+        (void)cache.stipple(view, 0.3f);
+
+        // The top bit of the first row's last word is past column 100.
+        char const padding_bit{ static_cast<char>(0x80) };
+        patch(path, mask_offset + (2 * sizeof(uint64_t)) - 1, &padding_bit, 1);
+        check(!cache.find(key), "padding bit set misses");
+        check(same_stipple(cache.stipple(view, 0.3f), expected), "damaged file replaced");
+    }
+
+    std::error_code ignored;
+    fs::remove_all(directory, ignored);
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+// Checks of the stippling modes that place samples differently from the
+// plain stippler: they still place size * percentage samples, each on its
+// own pixel, and place them the same way every run.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <mdspan>
+#include <set>
+#include <stippled_image.h>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    int failures{ 0 };
+
+    auto check(bool ok, std::string_view what, size_t rows, size_t cols, float percentage) -> void
+    {
+        if (!ok)
+        {
+            ++failures;
+            std::printf("FAIL %.*s %zux%zu percentage %g\n", static_cast<int>(what.size()), what.data(), rows, cols, static_cast<double>(percentage));
+        }
+    }
+
+    auto unique_count(brma::sample_spans samples) -> size_t
+    {
+        std::set<std::pair<uint32_t, uint32_t>> pixels;
+        for (size_t k = 0; k < samples.size(); ++k)
+        {
+            pixels.emplace(samples.rows[k], samples.cols[k]);
+        }
+
+        return pixels.size();
+    }
+
+    auto same_samples(brma::sample_spans a, brma::sample_spans b) -> bool
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+
+        for (size_t k = 0; k < a.size(); ++k)
+        {
+            if (a.rows[k] != b.rows[k] || a.cols[k] != b.cols[k])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // The left half black, the right half white.
+    auto half_image(size_t rows, size_t cols) -> std::vector<float>
+    {
+        std::vector<float> ret(rows * cols);
+        for (size_t i = 0; i < rows; ++i)
+        {
+            for (size_t j = 0; j < cols; ++j)
+            {
+                ret[(i * cols) + j] = j < cols / 2 ? 0.0f : 1.0f;
+            }
+        }
+
+        return ret;
+    }
+
+    // A smooth diagonal ramp, with few ties.
+    auto ramp_image(size_t rows, size_t cols) -> std::vector<float>
+    {
+        std::vector<float> ret(rows * cols);
+        for (size_t i = 0; i < rows; ++i)
+        {
+            for (size_t j = 0; j < cols; ++j)
+            {
+                ret[(i * cols) + j] = static_cast<float>(i + (2 * j)) / static_cast<float>(rows + (2 * cols));
+            }
+        }
+
+        return ret;
+    }
+
+    // The original full-frame stippler of a square image: the whole energy
+    // scanned for its first minimum, then the Gaussian splat, rolled to it,
+    // added everywhere.
+    auto reference_samples(std::vector<float> const &image, size_t n, float percentage, float sigma, float content_bias, bool negate)
+        -> std::vector<std::pair<size_t, size_t>>
+    {
+        std::vector<float> xs;
+        for (size_t k = 0; k < n / 2; ++k)
+        {
+            xs.push_back(static_cast<float>(k));
+        }
+
+        for (size_t k = n / 2; k > 0; --k)
+        {
+            xs.push_back(static_cast<float>(k));
+        }
+
+        float const sqrt_half{ std::sqrt(0.5f) };
+        std::vector<float> gauss;
+        for (float const x : xs)
+        {
+            float const p1{ std::erf((x - 0.5f) / sigma * sqrt_half) };
+            float const p2{ std::erf((x + 0.5f) / sigma * sqrt_half) };
+            gauss.push_back((p2 - p1) / 2.0f);
+        }
+
+        std::vector<float> lut(n * n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                lut[(i * n) + j] = gauss[i] * gauss[j];
+            }
+        }
+
+        lut[0] = std::numeric_limits<float>::infinity();
+        float const sign{ negate ? -1.0f : 1.0f };
+        std::vector<float> energy(n * n);
+        for (size_t k = 0; k < n * n; ++k)
+        {
+            energy[k] = image[k] * content_bias * sign;
+        }
+
+        std::vector<std::pair<size_t, size_t>> ret;
+        auto const sample_count{ static_cast<size_t>(static_cast<float>(n * n) * percentage) };
+        for (size_t iter = 0; iter < sample_count; ++iter)
+        {
+            auto const pos{ static_cast<size_t>(std::ranges::min_element(energy) - energy.begin()) };
+            size_t const x{ pos / n };
+            size_t const y{ pos % n };
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t j = 0; j < n; ++j)
+                {
+                    energy[(i * n) + j] += lut[(((i + n - x) % n) * n) + ((j + n - y) % n)];
+                }
+            }
+
+            ret.emplace_back(x, y);
+        }
+
+        return ret;
+    }
+
+    // With window_sigmas = 0 the stippler must place exactly the original
+    // full-frame stippler's samples.
+    auto check_full_frame(std::vector<float> const &image, size_t n, float percentage, float sigma, bool negate) -> void
+    {
+        std::vector<float> input{ image };
+        std::mdspan const view{ input.data(), n, n };
+        brma::stippled_image const stipple{ view, percentage, sigma, 0.5f, negate, 0.0f };
+        std::vector<std::pair<size_t, size_t>> const expected{ reference_samples(image, n, percentage, sigma, 0.5f, negate) };
+        brma::sample_spans const samples{ stipple.samples() };
+        bool same{ samples.size() == expected.size() };
+        for (size_t k = 0; same && k < samples.size(); ++k)
+        {
+            same = samples.rows[k] == expected[k].first && samples.cols[k] == expected[k].second;
+        }
+
+        check(same, negate ? "full frame matches the original, negated" : "full frame matches the original", n, n, percentage);
+    }
+
+    auto check_tiled(size_t rows, size_t cols, float percentage) -> void
+    {
+        std::vector<float> image{ half_image(rows, cols) };
+        std::mdspan const view{ image.data(), rows, cols };
+        auto const expected{ static_cast<size_t>(static_cast<float>(rows * cols) * percentage) };
+        brma::stippled_image const tiled{ std::execution::par, view, percentage, 0.9f, 1.0f, false, 4.0f, size_t{ 32 } };
+        brma::stippled_image const again{ std::execution::par, view, percentage, 0.9f, 1.0f, false, 4.0f, size_t{ 32 } };
+        check(tiled.samples().size() == expected, "tiled sample count", rows, cols, percentage);
+        check(unique_count(tiled.samples()) == expected, "tiled unique samples", rows, cols, percentage);
+        check(same_samples(tiled.samples(), again.samples()), "tiled determinism", rows, cols, percentage);
+    }
+
+    auto check_batched(size_t rows, size_t cols, size_t batch, float percentage) -> void
+    {
+        std::vector<float> image{ half_image(rows, cols) };
+        std::mdspan const view{ image.data(), rows, cols };
+        auto const expected{ static_cast<size_t>(static_cast<float>(rows * cols) * percentage) };
+        brma::stippled_image const batched{ brma::batched{ batch }, view, percentage };
+        check(batched.samples().size() == expected, "batched sample count", rows, cols, percentage);
+        check(unique_count(batched.samples()) == expected, "batched unique samples", rows, cols, percentage);
+    }
+
+    template <typename Energy>
+    auto check_precision(size_t rows, size_t cols, float percentage, bool negate) -> void
+    {
+        std::vector<float> image{ half_image(rows, cols) };
+        std::mdspan const view{ image.data(), rows, cols };
+        auto const expected{ static_cast<size_t>(static_cast<float>(rows * cols) * percentage) };
+        brma::stippled_image const stipple{ brma::precision<Energy>{}, view, percentage, 0.9f, 0.5f, negate };
+        check(stipple.samples().size() == expected, "precision sample count", rows, cols, percentage);
+        check(unique_count(stipple.samples()) == expected, "precision unique samples", rows, cols, percentage);
+    }
+}
+
+int main()
+{
+    for (float const percentage : { 0.33f, 0.6f, 0.7f, 0.8f })
+    {
+        check_tiled(256, 256, percentage);
+    }
+
+    for (size_t const n : { size_t{ 16 }, size_t{ 64 }, size_t{ 96 } })
+    {
+        for (auto const &image : { half_image(n, n), ramp_image(n, n) })
+        {
+            for (float const percentage : { 0.1f, 0.33f, 0.6f })
+            {
+                for (float const sigma : { 0.9f, 1.5f })
+                {
+                    check_full_frame(image, n, percentage, sigma, false);
+                    check_full_frame(image, n, percentage, sigma, true);
+                }
+            }
+        }
+    }
+
+    check_tiled(96, 128, 1.0f);
+    check_tiled(128, 96, 1.0f);
+    check_batched(64, 64, 16, 1.0f);
+    check_batched(128, 96, 64, 1.0f);
+    check_batched(256, 256, 64, 0.5f);
+
+    // Placed pixels stay infinite whatever is added to them, and zeros of
+    // either sign tie.
+    for (bool const negate : { false, true })
+    {
+        check_precision<brma::bfloat16_energy>(64, 64, 1.0f, negate);
+        check_precision<brma::fixed16_energy<>>(64, 64, 1.0f, negate);
+    }
+
+    using fixed16 = brma::fixed16_energy<>;
+    check(fixed16::add(fixed16::encode(std::numeric_limits<float>::infinity()), fixed16::encode(-1.0f)) == fixed16::encode(std::numeric_limits<float>::infinity()), "fixed16 infinity absorbs", 1, 1, 1.0f);
+    check(brma::bfloat16_energy::encode(-0.0f) == brma::bfloat16_energy::encode(0.0f), "bfloat16 signed zeros tie", 1, 1, 1.0f);
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}